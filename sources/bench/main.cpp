@@ -0,0 +1,364 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::sort, std::min
+#include <chrono>       // std::chrono::steady_clock
+#include <cstdio>       // std::printf
+#include <fstream>      // std::ofstream
+#include <memory>       // std::unique_ptr
+#include <string>       // std::string
+#include <string_view>  // std::string_view
+#include <unordered_map>// std::unordered_map
+#include <utility>      // std::move, std::forward
+#include <vector>       // std::vector
+
+// POSIX
+#include <fcntl.h>          // open
+#include <sys/resource.h>   // getrlimit, setrlimit
+#include <sys/stat.h>       // stat, fstat
+#include <unistd.h>         // read, write, pread, close
+
+// internal
+#include <io.h>
+
+/********** main.cpp **********/
+
+/**
+ * Benchmarks the io module against the equivalent raw POSIX calls.
+ *
+ * Usage: faber_bench [output.json] [--quick]
+ *
+ * Every case is run for a number of iterations, the latency of each iteration is
+ * recorded and summarized as percentiles. Results are printed as a table and
+ * written as JSON (to `faber_bench.json` by default) so runs can be diffed.
+ * Build with optimizations (`-DCMAKE_BUILD_TYPE=Release`) for meaningful numbers.
+*/
+
+namespace {
+
+    namespace io = faber::io;
+    namespace fs = io::fs;
+
+    using clock_type = std::chrono::steady_clock;
+
+    /********** Results **********/
+
+    struct result {
+        std::string     name;       // operation being measured
+        std::string     variant;    // "faber" or "posix"
+        std::size_t     file_size;  // bytes per file, 0 if not applicable
+        std::size_t     file_count; // files touched per iteration
+        std::size_t     iterations;
+        double          mib_per_s;  // 0 if not applicable
+        double          ops_per_s;
+        double          p50_us;
+        double          p90_us;
+        double          p99_us;
+        double          max_us;
+    };
+
+    std::vector<result> results{};
+
+    /**
+     * Runs `fn` `iterations` times (after a short warm-up) and records a result.
+     * `bytes` is the amount of data moved by a single iteration. `teardown` runs
+     * after every iteration and is not measured.
+    */
+    template<typename Fn, typename Teardown>
+    void measure(std::string name, std::string variant, std::size_t file_size, std::size_t file_count,
+                 std::size_t iterations, std::size_t bytes, Fn&& fn, Teardown&& teardown) {
+        for (std::size_t i = 0; i < std::min<std::size_t>(iterations / 10 + 1, 10); ++i) {
+            fn(i);
+            teardown();
+        }
+
+        std::vector<double> samples{};
+        samples.reserve(iterations);
+        double total_s = 0.0;
+        for (std::size_t i = 0; i < iterations; ++i) {
+            const auto t0 = clock_type::now();
+            fn(i);
+            const auto t1 = clock_type::now();
+            teardown();
+            samples.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+            total_s += std::chrono::duration<double>(t1 - t0).count();
+        }
+
+        std::sort(samples.begin(), samples.end());
+        const auto percentile = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+        };
+
+        results.push_back(result{
+            std::move(name), std::move(variant), file_size, file_count, iterations,
+            bytes ? (static_cast<double>(bytes) * iterations / (1024.0 * 1024.0)) / total_s : 0.0,
+            (static_cast<double>(iterations) * file_count) / total_s,
+            percentile(0.50), percentile(0.90), percentile(0.99), samples.back()
+        });
+
+        const auto& r = results.back();
+        std::printf("%-22s %-6s %10zu B %7zu files %10.1f MiB/s %12.0f ops/s  p50 %9.2f us  p99 %9.2f us\n",
+            r.name.c_str(), r.variant.c_str(), r.file_size, r.file_count, r.mib_per_s, r.ops_per_s, r.p50_us, r.p99_us);
+    }
+
+    template<typename Fn>
+    void measure(std::string name, std::string variant, std::size_t file_size, std::size_t file_count,
+                 std::size_t iterations, std::size_t bytes, Fn&& fn) {
+        measure(std::move(name), std::move(variant), file_size, file_count, iterations, bytes, std::forward<Fn>(fn), [] { });
+    }
+
+    bool write_json(const std::string& path) {
+        std::ofstream out{path};
+        out << "{\n  \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            out << "    { \"name\": \"" << r.name << "\", \"variant\": \"" << r.variant << "\""
+                << ", \"file_size\": " << r.file_size << ", \"file_count\": " << r.file_count
+                << ", \"iterations\": " << r.iterations << ", \"mib_per_s\": " << r.mib_per_s
+                << ", \"ops_per_s\": " << r.ops_per_s << ", \"latency_us\": { \"p50\": " << r.p50_us
+                << ", \"p90\": " << r.p90_us << ", \"p99\": " << r.p99_us << ", \"max\": " << r.max_us << " } }"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+        return out.good();
+    }
+
+    /********** Fixtures **********/
+
+    void make_file(const std::string& path, std::size_t size) {
+        std::string data(size, 'x');
+        for (std::size_t i = 63; i < size; i += 64) { data[i] = '\n'; }
+        io::write_file(path, [&data](std::fstream& file) -> bool {
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+            return file.good();
+        });
+    }
+
+    /** Raises the soft descriptor limit as far as allowed, returns the new limit. */
+    std::size_t raise_fd_limit() {
+        rlimit lim{};
+        ::getrlimit(RLIMIT_NOFILE, &lim);
+        lim.rlim_cur = lim.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &lim);
+        ::getrlimit(RLIMIT_NOFILE, &lim);
+        return static_cast<std::size_t>(lim.rlim_cur);
+    }
+
+    /** Scales iteration counts down with the amount of data per iteration. */
+    std::size_t iterations_for(std::size_t bytes, bool quick) {
+        const std::size_t budget = quick ? (64U << 20) : (1024U << 20);
+        return std::clamp<std::size_t>(budget / std::max<std::size_t>(bytes, 1), 5, quick ? 2000 : 20000);
+    }
+
+    /********** Benchmarks **********/
+
+    void bench_read_write(const fs::path& dir, bool quick) {
+        for (const std::size_t size : { 4UL << 10, 64UL << 10, 1UL << 20, 16UL << 20 }) {
+            const auto path  = (dir / ("rw_" + std::to_string(size))).string();
+            const auto iters = iterations_for(size, quick);
+            make_file(path, size);
+            std::vector<char> buffer(size);
+
+            measure("read_file", "faber", size, 1, iters, size, [&](std::size_t) {
+                io::read_file(path, [&buffer](std::fstream& file) -> bool {
+                    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    return file.good();
+                });
+            });
+            measure("read_file", "posix", size, 1, iters, size, [&](std::size_t) {
+                const int fd = ::open(path.c_str(), O_RDONLY);
+                for (std::size_t done = 0; done < size; ) {
+                    const auto n = ::read(fd, buffer.data() + done, size - done);
+                    if (n <= 0) { break; }
+                    done += static_cast<std::size_t>(n);
+                }
+                ::close(fd);
+            });
+
+            measure("write_file", "faber", size, 1, iters, size, [&](std::size_t) {
+                io::write_file(path, [&buffer](std::fstream& file) -> bool {
+                    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    return file.good();
+                });
+            });
+            measure("write_file", "posix", size, 1, iters, size, [&](std::size_t) {
+                const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                for (std::size_t done = 0; done < size; ) {
+                    const auto n = ::write(fd, buffer.data() + done, size - done);
+                    if (n <= 0) { break; }
+                    done += static_cast<std::size_t>(n);
+                }
+                ::close(fd);
+            });
+
+            // Reads the first block and appends nothing, i.e. an open-read-close round trip in (in|out).
+            constexpr std::size_t block = 4096;
+            measure("open_file_then", "faber", size, 1, iters, block, [&](std::size_t) {
+                io::open_file_then(path, [&buffer](std::fstream& file) -> bool {
+                    file.read(buffer.data(), block);
+                    return file.good();
+                });
+            });
+            measure("open_file_then", "posix", size, 1, iters, block, [&](std::size_t) {
+                const int fd = ::open(path.c_str(), O_RDWR);
+                [[maybe_unused]] const auto n = ::pread(fd, buffer.data(), block, 0);
+                ::close(fd);
+            });
+        }
+    }
+
+    void bench_filesize(const fs::path& dir, bool quick) {
+        const auto path  = (dir / "filesize").string();
+        const auto iters = quick ? 20000 : 200000;
+        make_file(path, 1 << 20);
+
+        measure("filesize(string)", "faber", 1 << 20, 1, iters, 0, [&](std::size_t) {
+            [[maybe_unused]] volatile auto size = io::filesize(path);
+        });
+        measure("filesize(string)", "posix", 1 << 20, 1, iters, 0, [&](std::size_t) {
+            struct stat st{};
+            ::stat(path.c_str(), &st);
+            [[maybe_unused]] volatile auto size = st.st_size;
+        });
+
+        std::fstream file{path, std::fstream::in};
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        measure("filesize(fstream)", "faber", 1 << 20, 1, iters, 0, [&](std::size_t) {
+            [[maybe_unused]] volatile auto size = io::filesize(file);
+        });
+        measure("filesize(fstream)", "posix", 1 << 20, 1, iters, 0, [&](std::size_t) {
+            struct stat st{};
+            ::fstat(fd, &st);
+            [[maybe_unused]] volatile auto size = st.st_size;
+        });
+        ::close(fd);
+
+        // Metadata of a whole directory's worth of files, one batch per iteration.
+        constexpr std::size_t count = 1000;
+        std::vector<std::string> paths{};
+        paths.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            paths.push_back((dir / ("md_" + std::to_string(i))).string());
+            make_file(paths.back(), 64);
+        }
+        const auto batches = quick ? 20 : 200;
+        measure("stat_files", "faber", 64, count, batches, 0, [&](std::size_t) {
+            [[maybe_unused]] const auto metadata = io::stat_files(paths);
+        });
+        measure("stat_files", "posix", 64, count, batches, 0, [&](std::size_t) {
+            for (const auto& p : paths) {
+                struct stat st{};
+                ::stat(p.c_str(), &st);
+            }
+        });
+    }
+
+    void bench_stream_churn(const fs::path& dir, bool quick) {
+        const auto path  = (dir / "churn").string();
+        const auto iters = quick ? 20000 : 200000;
+        make_file(path, 4096);
+
+        // Short-lived streams: open, read a few bytes, close.
+        constexpr std::size_t block = 64;
+        char buffer[block];
+        measure("stream open/read/close", "faber", 4096, 1, iters, block, [&](std::size_t) {
+            io::fd_stream file{path, std::ios_base::in};
+            file.read(buffer, block);
+        });
+        measure("stream open/read/close", "posix", 4096, 1, iters, block, [&](std::size_t) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            [[maybe_unused]] const auto n = ::read(fd, buffer, block);
+            ::close(fd);
+        });
+
+        // The same churn through a monitor, which recycles stream buffers and filenames.
+        io::file_monitor monitor{};
+        measure("monitor open/close", "faber", 4096, 1, iters, block, [&](std::size_t) {
+            monitor.open(path.c_str(), std::fstream::in).read(buffer, block);
+            monitor.close(path);
+        });
+    }
+
+    void bench_file_monitor(const fs::path& dir, bool quick) {
+        const auto fd_limit = raise_fd_limit();
+
+        for (const std::size_t count : { 100UL, 1000UL, 10000UL }) {
+            // Leave room for stdio, the fixtures and the raw descriptors of the baseline.
+            if (count + 64 > fd_limit) {
+                std::printf("skipping file_monitor with %zu files, descriptor limit is %zu\n", count, fd_limit);
+                continue;
+            }
+
+            std::vector<std::string> paths{};
+            paths.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                paths.push_back((dir / ("fm_" + std::to_string(i))).string());
+                make_file(paths.back(), 64);
+            }
+            const auto iters = quick ? 3 : 10;
+
+            // Every iteration opens all files on a fresh monitor, closing them is not measured.
+            std::unique_ptr<io::file_monitor> monitor{};
+            measure("file_monitor::open", "faber", 64, count, iters, 0, [&](std::size_t) {
+                monitor = std::make_unique<io::file_monitor>();
+                for (const auto& p : paths) {
+                    monitor->open(p.c_str());
+                }
+            }, [&] { monitor.reset(); });
+            std::vector<int> fds(count, -1);
+            measure("file_monitor::open", "posix", 64, count, iters, 0, [&](std::size_t) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    fds[i] = ::open(paths[i].c_str(), O_RDWR);
+                }
+            }, [&] { for (auto& fd : fds) { ::close(fd); fd = -1; } });
+
+            // Opened once more for the lookups below.
+            monitor = std::make_unique<io::file_monitor>();
+            for (std::size_t i = 0; i < count; ++i) {
+                monitor->open(paths[i].c_str());
+            }
+
+            // Lookups, the baseline being a hash map from path to an index.
+            std::unordered_map<std::string, std::size_t> by_path{};
+            for (std::size_t i = 0; i < count; ++i) { by_path.emplace(paths[i], i); }
+
+            const auto lookups = quick ? 100000 : 1000000;
+            measure("file_monitor::find", "faber", 64, 1, lookups, 0, [&](std::size_t i) {
+                [[maybe_unused]] volatile bool found = monitor->find(paths[i % count]) != monitor->data().cend();
+            });
+            measure("file_monitor::find", "posix", 64, 1, lookups, 0, [&](std::size_t i) {
+                [[maybe_unused]] volatile bool found = by_path.find(paths[i % count]) != by_path.end();
+            });
+        }
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string output{"faber_bench.json"};
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view{argv[i]} == "--quick") { quick = true; }
+        else { output = argv[i]; }
+    }
+
+    const auto dir = fs::temp_directory_path() / "faber_bench";
+    fs::remove_all(dir);
+    if (not io::try_mkdirs(dir)) {
+        return 1;
+    }
+
+    bench_read_write(dir, quick);
+    bench_filesize(dir, quick);
+    bench_stream_churn(dir, quick);
+    bench_file_monitor(dir, quick);
+
+    fs::remove_all(dir);
+
+    if (not write_json(output)) {
+        std::fprintf(stderr, "[ERROR] Failed to write `%s`\n", output.c_str());
+        return 1;
+    }
+    std::printf("results written to `%s`\n", output.c_str());
+    return 0;
+}
@@ -0,0 +1,229 @@
+#ifndef FABER_ASYNC_H
+#define FABER_ASYNC_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <concepts>     // std::invocable
+#include <coroutine>    // std::coroutine_handle
+#include <cstddef>      // std::size_t
+#include <exception>    // std::exception_ptr
+#include <functional>   // std::function, std::invoke
+#include <optional>     // std::optional
+#include <string>       // std::string
+#include <thread>       // std::thread::hardware_concurrency
+#include <type_traits>  // std::invoke_result_t, std::decay_t, std::is_void_v
+#include <utility>      // std::move, std::forward
+
+// internal
+#include <io.h>
+#include <thread_pool.h>
+
+/********** async.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /********** Executors **********/
+
+        /**
+         * Where awaitable operations run their blocking part. Implement `execute` to
+         * plug in any scheduler: a thread pool, an event loop's worker queue, etc.
+        */
+        class executor {
+        public:
+            virtual ~executor() = default;
+
+            /** Runs `task` at some point, on any thread. Must not run it inline. */
+            virtual void execute(std::function<void()> task) = 0;
+        };
+
+        /** Executor backed by an `io::thread_pool` of its own. */
+        class pool_executor final : public executor {
+        public:
+            /********** Constructors & Destructor **********/
+
+            explicit pool_executor(std::size_t threads = std::thread::hardware_concurrency());
+
+            pool_executor(const pool_executor&) = delete; // copy constructor (deleted)
+            pool_executor(pool_executor&&)      = delete; // move constructor (deleted)
+
+            ~pool_executor() override = default; // runs the tasks still queued, then joins
+
+        public:
+            /********** Public Member Functions **********/
+
+            void execute(std::function<void()> task) override;
+
+            std::size_t size() const noexcept; // number of worker threads
+
+            pool_executor& operator=(const pool_executor&) = delete; // copy assignment (deleted)
+            pool_executor& operator=(pool_executor&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Members **********/
+
+            thread_pool _pool;
+        }; // class pool_executor
+
+        /** Process-wide `pool_executor`, created on first use, used when none is given. */
+        executor& default_executor();
+
+        /********** Awaitables **********/
+
+        /**
+         * Awaitable running a callable on an executor. The awaiting coroutine is
+         * suspended, the callable runs on the executor and the coroutine is resumed on
+         * the same thread right after, `co_await` yielding the callable's result or
+         * rethrowing its exception. See `io::offload`.
+        */
+        template<typename Fn>
+        class offload_awaitable {
+        public:
+            using result_type = std::invoke_result_t<Fn&>;
+            static_assert(not std::is_void_v<result_type>, "offloaded callables must return a value");
+
+            offload_awaitable(executor& ex, Fn fn) : _executor(ex), _fn(std::move(fn)) { }
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                _executor.execute([this, handle] {
+                    try {
+                        _result.emplace(std::invoke(_fn));
+                    } catch (...) {
+                        _error = std::current_exception();
+                    }
+                    handle.resume(); // `this` may be gone past this point
+                });
+            }
+
+            result_type await_resume() {
+                if (_error) {
+                    std::rethrow_exception(_error);
+                }
+                return std::move(*_result);
+            }
+
+        private:
+            executor&                   _executor;
+            Fn                          _fn;
+            std::optional<result_type>  _result{};
+            std::exception_ptr          _error{};
+        };
+
+        /** Awaitable moving the awaiting coroutine to an executor, see `io::schedule`. */
+        class schedule_awaitable {
+        public:
+            explicit schedule_awaitable(executor& ex) noexcept : _executor(ex) { }
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { _executor.execute([handle] { handle.resume(); }); }
+            void await_resume() const noexcept { }
+
+        private:
+            executor& _executor;
+        };
+
+        /********** API **********/
+
+        /**
+         * Runs any blocking callable on an executor, without blocking the awaiting
+         * coroutine's thread.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     const bool copied = co_await io::offload([] {
+         *         return io::copy_file("path/to/src", "path/to/dst");
+         *     });
+         * `
+        */
+        template<typename Fn>
+        auto
+        offload(Fn&& fn, executor& ex = default_executor()) {
+            return offload_awaitable<std::decay_t<Fn>>{ex, std::forward<Fn>(fn)};
+        }
+
+        /**
+         * Resumes the awaiting coroutine on `ex`. Operations resume their coroutine on
+         * the executor that ran them, use this to get back to, say, an event loop.
+        */
+        inline schedule_awaitable
+        schedule(executor& ex) noexcept {
+            return schedule_awaitable{ex};
+        }
+
+        /**
+         * Awaitable counterpart of `io::read_file`. The file is opened, passed to the
+         * callback and closed on `ex`, `co_await` yields the callback's result.
+         *
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         *
+         *     std::string header{};
+         *     const bool ok = co_await io::async_read_file("path/to/file"s, [&header](std::fstream& file) -> bool {
+         *         return static_cast<bool>(std::getline(file, header));
+         *     });
+         * `
+         *
+         * The filename and callback are copied (or moved) into the operation, objects
+         * the callback refers to must outlive the `co_await`.
+        */
+        template<typename Invocable>
+        requires std::invocable<Invocable, std::fstream&>
+        auto
+        async_read_file(std::string filename, Invocable&& callback, std::fstream::openmode mode = std::fstream::in, executor& ex = default_executor()) {
+            return offload([filename = std::move(filename), callback = std::forward<Invocable>(callback), mode]() mutable {
+                return read_file(filename, callback, mode);
+            }, ex);
+        }
+
+        /** Awaitable counterpart of the memory-mapped `io::read_file`. */
+        template<typename Invocable>
+        requires std::invocable<Invocable, std::span<const std::byte>>
+        auto
+        async_read_file(std::string filename, Invocable&& callback, executor& ex = default_executor()) {
+            return offload([filename = std::move(filename), callback = std::forward<Invocable>(callback)]() mutable {
+                return read_file(filename, callback);
+            }, ex);
+        }
+
+        /** Awaitable counterpart of `io::write_file`, see `io::async_read_file`. */
+        template<typename Invocable>
+        requires std::invocable<Invocable, std::fstream&>
+        auto
+        async_write_file(std::string filename, Invocable&& callback, std::fstream::openmode mode = (std::fstream::out | std::fstream::trunc), executor& ex = default_executor()) {
+            return offload([filename = std::move(filename), callback = std::forward<Invocable>(callback), mode]() mutable {
+                return write_file(filename, callback, mode);
+            }, ex);
+        }
+
+        /** Awaitable counterpart of the byte-sink `io::write_file`, see `io::async_read_file`. */
+        template<typename Invocable>
+        requires (not std::invocable<Invocable, std::fstream&> and std::invocable<Invocable, byte_sink&>)
+        auto
+        async_write_file(std::string filename, Invocable&& callback, const sink_options& options = {}, executor& ex = default_executor()) {
+            return offload([filename = std::move(filename), callback = std::forward<Invocable>(callback), options]() mutable {
+                return write_file(filename, callback, options);
+            }, ex);
+        }
+
+        /** Awaitable counterpart of `io::open_file_then`, see `io::async_read_file`. */
+        template<typename Invocable>
+        requires std::invocable<Invocable, std::fstream&>
+        auto
+        async_open_file_then(std::string filename, Invocable&& callback, std::fstream::openmode mode = (std::fstream::in | std::fstream::out), executor& ex = default_executor()) {
+            return offload([filename = std::move(filename), callback = std::forward<Invocable>(callback), mode]() mutable {
+                return open_file_then(filename, callback, mode);
+            }, ex);
+        }
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_ASYNC_H
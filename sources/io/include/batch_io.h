@@ -0,0 +1,224 @@
+#ifndef FABER_BATCH_IO_H
+#define FABER_BATCH_IO_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <chrono>               // std::chrono::steady_clock
+#include <condition_variable>   // std::condition_variable
+#include <cstddef>              // std::byte, std::size_t
+#include <cstdint>              // std::uint64_t, std::int64_t
+#include <memory>               // std::unique_ptr
+#include <mutex>                // std::mutex
+#include <span>                 // std::span
+#include <string>               // std::string
+#include <string_view>          // std::string_view
+#include <unordered_map>        // std::unordered_map
+#include <vector>               // std::vector
+
+// internal
+#include <file_monitor.h>
+#include <thread_pool.h>
+
+/********** batch_io.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /**
+         * Batch submission engine for reads and writes against files registered on a
+         * `file_monitor`.
+         *
+         * Operations are queued with `queue_read`/`queue_write`, handed to the kernel
+         * all at once by `submit` and collected with `wait`. On Linux the engine is
+         * backed by an io_uring instance, so a whole batch costs a single system call.
+         * If io_uring is unavailable (old kernel, seccomp filter, etc) it falls back to
+         * a thread pool issuing `pread`/`pwrite`, with the same observable behaviour.
+         * Kernels whose io_uring lacks plain reads and writes (before 5.6) use the
+         * fallback as well.
+         *
+         * The engine keeps its own raw descriptor for every file it touches, opened
+         * according to the `mode` recorded by the monitor. It does NOT go through the
+         * monitor's `std::fstream`s, so pending stream output must be flushed by the
+         * caller before queueing reads that depend on it.
+         *
+         * If the monitor collects stats (see `file_monitor::enable_stats`) every
+         * operation is recorded on its file's counters once completed, so a file must
+         * not be closed on the monitor while operations on it are in flight.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     io::file_monitor monitor{ "path/to/file1", "path/to/file2" };
+         *     io::batch_io batch{monitor};
+         *
+         *     std::array<std::byte, 512> a{}, b{};
+         *     batch.queue_read("path/to/file1", a, 0);
+         *     batch.queue_read("path/to/file2", b, 4096);
+         *     batch.submit();
+         *
+         *     std::vector<io::batch_io::completion> done{};
+         *     batch.wait(done, 2);
+         * `
+         *
+         * An instance must be driven from one thread at a time.
+        */
+        class batch_io {
+        public:
+            /********** Public Types **********/
+
+            /** Outcome of a single queued operation. */
+            struct completion {
+                std::uint64_t id;       /** Identifier returned when the operation was queued. */
+                std::int64_t  result;   /** Bytes transferred, or a negated `errno` value on failure. */
+            };
+
+            /** Longest single operation, the length field of an io_uring submission is 32 bits wide. */
+            static constexpr std::size_t max_length = UINT32_MAX;
+
+        private:
+            /********** Private Types **********/
+
+            /** A queued operation, waiting for `submit`. */
+            struct operation {
+                std::uint64_t   id;
+                int             fd;
+                std::byte*      buffer;
+                std::size_t     length;
+                std::uint64_t   offset;
+                bool            write;
+                file_stats*     stats;  // null unless the monitor collects stats
+            };
+
+            /** Operation owned by the kernel whose outcome goes to the file's stats. */
+            struct tracked {
+                file_stats*                             stats;
+                std::chrono::steady_clock::time_point   submitted;
+                bool                                    write;
+            };
+
+            /** Engine descriptor of a monitored path, with the inode it was opened on. */
+            struct descriptor {
+                int             fd;
+                std::uint64_t   device;
+                std::uint64_t   inode;
+            };
+
+            struct ring; // io_uring instance, defined in batch_io.cpp
+
+            /** Transparent hash, allows looking up `std::string` keys by `std::string_view`. */
+            struct string_hash {
+                using is_transparent = void;
+                std::size_t operator()(std::string_view sv) const noexcept { return std::hash<std::string_view>{}(sv); }
+            };
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            /**
+             * @param monitor Monitor whose registered files may be targeted. Must outlive
+             *        this object.
+             * @param queue_depth Maximum number of operations in flight at once. Larger
+             *        batches are split transparently.
+            */
+            explicit batch_io(file_monitor& monitor, unsigned queue_depth = 256);
+
+            batch_io(const batch_io&) = delete; // copy constructor (deleted)
+            batch_io(batch_io&&)      = delete; // move constructor (deleted)
+
+            ~batch_io(); // waits for operations in flight and closes the engine's descriptors
+
+        public:
+            /********** Public Member Functions **********/
+
+            /**
+             * Queues a read of up to `buffer.size()` bytes at `offset` of a monitored file.
+             * The buffer must stay valid until the operation's completion is collected.
+             *
+             * @throws std::runtime_error if `filename` is not registered on the monitor,
+             *         was not opened for reading, could not be opened by the engine, or
+             *         the buffer is larger than `max_length`.
+             *
+             * @returns An identifier reported back in the operation's `completion`.
+            */
+            std::uint64_t queue_read(std::string_view filename, std::span<std::byte> buffer, std::uint64_t offset);
+
+            /**
+             * Queues a write of `buffer` at `offset` of a monitored file. The buffer must
+             * stay valid until the operation's completion is collected.
+             *
+             * @throws std::runtime_error if `filename` is not registered on the monitor,
+             *         was not opened for writing, could not be opened by the engine, or
+             *         the buffer is larger than `max_length`.
+             *
+             * @returns An identifier reported back in the operation's `completion`.
+            */
+            std::uint64_t queue_write(std::string_view filename, std::span<const std::byte> buffer, std::uint64_t offset);
+
+            /**
+             * Hands every queued operation to the kernel (or the fallback pool).
+             *
+             * @throws std::runtime_error if the kernel rejects the submission. Operations
+             *         handed over before the failure stay in flight, the others stay
+             *         queued for the next `submit`.
+             *
+             * @returns The number of operations submitted.
+            */
+            std::size_t submit();
+
+            /**
+             * Collects completed operations, blocking until at least `min_completions`
+             * are available or nothing is left in flight. Completions are appended to
+             * `out` in no particular order.
+             *
+             * @returns The number of completions appended to `out`.
+            */
+            std::size_t wait(std::vector<completion>& out, std::size_t min_completions = 1);
+
+            std::size_t in_flight() const noexcept; // submitted operations not yet collected
+            bool uses_io_uring() const noexcept;    // `false` if running on the fallback pool
+
+            batch_io& operator=(const batch_io&) = delete; // copy assignment (deleted)
+            batch_io& operator=(batch_io&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Member Functions **********/
+
+            int descriptor_for(std::string_view filename, bool write, file_stats*& stats); // lazily opened, cached per inode
+            void close_retired(); // closes replaced descriptors once no operation can use them
+            std::uint64_t enqueue(std::string_view filename, std::byte* buffer, std::size_t length, std::uint64_t offset, bool write);
+
+            std::size_t submit_ring();
+            std::size_t submit_pool();
+            void reap_ring(unsigned min_completions); // moves ring completions into `_completed`
+
+        private:
+            /********** Private Members **********/
+
+            file_monitor&                                               _monitor;
+            unsigned                                                    _queue_depth;
+            std::unordered_map<std::string, descriptor, string_hash, std::equal_to<>> _descriptors{};
+            std::vector<int>                                            _retired{}; // replaced, still used by queued operations
+
+            std::vector<operation>  _queued{};
+            std::vector<completion> _completed{};   // reaped from the completion ring, not yet collected
+            std::size_t             _in_flight{0};  // submitted, not yet collected by `wait`
+            std::uint64_t           _next_id{0};
+            std::unordered_map<std::uint64_t, tracked> _tracked{}; // io_uring operations to record, by id
+
+            std::unique_ptr<ring>   _ring{};    // null when running on the fallback pool
+
+            // Fallback engine state, `_pool` is only created if io_uring is unavailable.
+            std::mutex                      _mutex{};
+            std::condition_variable         _cv{};
+            std::vector<completion>         _pool_completed{};
+            std::unique_ptr<thread_pool>    _pool{};
+        }; // class batch_io
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_BATCH_IO_H
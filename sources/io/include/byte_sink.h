@@ -0,0 +1,133 @@
+#ifndef FABER_BYTE_SINK_H
+#define FABER_BYTE_SINK_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <cstddef>      // std::byte, std::size_t
+#include <span>         // std::span
+#include <string>       // std::string
+#include <string_view>  // std::string_view
+
+/********** byte_sink.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        class commit_group; // see commit_group.h
+
+        /** Tuning knobs for `byte_sink`. */
+        struct sink_options {
+            /** Size of the write buffer, rounded up to a multiple of the page size. */
+            std::size_t buffer_size = 1024 * 1024;
+
+            /**
+             * Opens the file with `O_DIRECT`, bypassing the page cache. Meant for bulk
+             * output that won't be read back soon. The final partial block is written
+             * without `O_DIRECT` when the sink is closed. Falls back to buffered output
+             * if the filesystem doesn't support it.
+            */
+            bool direct = false;
+
+            /**
+             * Crash-safe replacement of the file. Output goes to a temporary sibling
+             * file which, once the sink is closed successfully, is flushed to stable
+             * storage and renamed over the target, whose directory is flushed in turn.
+             * A crash leaves either the old contents or the new ones, never a torn file.
+             * If writing fails, or the sink is `discard`ed, the temporary file is
+             * removed and the target is left untouched. The permissions of an existing
+             * target are kept.
+            */
+            bool durable = false;
+
+            /**
+             * Flushes of a `durable` sink go through this group instead of one
+             * `fdatasync`/`fsync` pair per file, see `commit_group`. Ignored otherwise.
+            */
+            commit_group* group = nullptr;
+        };
+
+        /**
+         * Raw, buffered byte output to a file, without any iostream formatting.
+         *
+         * Bytes are gathered in a large page-aligned buffer which is written out with
+         * a single `write` when full. Writes larger than the free space flush the
+         * buffer and the new data together with one `writev`, so large payloads are
+         * never copied. The file is truncated on open.
+         *
+         * Once a system call fails the sink is put in a failed state, `good` returns
+         * `false` and every further write is ignored.
+         *
+         * With `sink_options::durable` the file is replaced atomically on `close`
+         * instead of being truncated on open. A durable sink destroyed without being
+         * closed (an exception thrown while writing, for instance) leaves the file
+         * untouched.
+        */
+        class byte_sink {
+        public:
+            /********** Constructors & Destructor **********/
+
+            byte_sink() = default; // not associated to any file
+
+            explicit byte_sink(const std::string& filename, const sink_options& options = {}); // check `is_open` afterwards
+
+            byte_sink(const byte_sink&) = delete; // copy constructor (deleted)
+            byte_sink(byte_sink&&)      = delete; // move constructor (deleted)
+
+            ~byte_sink(); // `discard`s the sink if still open: durable sinks roll back, others are flushed and closed, errors are lost
+
+        public:
+            /********** Public Member Functions **********/
+
+            bool open(const std::string& filename, const sink_options& options = {}); // closes the current file first
+            bool close(); // flushes and closes, `false` if anything failed since opening
+            void discard(); // closes, a durable sink removes its temporary file and leaves the target untouched
+
+            void write(std::span<const std::byte> bytes);
+            void write(std::string_view text);
+            void put(char c);
+
+            bool flush(); // writes out the buffer, `O_DIRECT` sinks keep a partial trailing block
+
+            bool is_open() const noexcept;
+            bool good() const noexcept;
+            bool direct() const noexcept; // `true` if `O_DIRECT` is actually in effect
+
+            std::size_t bytes_written() const noexcept; // bytes accepted so far, buffered or not
+
+            byte_sink& operator=(const byte_sink&) = delete; // copy assignment (deleted)
+            byte_sink& operator=(byte_sink&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Member Functions **********/
+
+            bool write_out(const std::byte* data, std::size_t size);
+            bool write_out(const std::byte* a, std::size_t a_size, const std::byte* b, std::size_t b_size);
+            bool flush_impl(bool final);
+            int open_temporary(const std::string& filename, int flags); // durable sinks, sibling of `filename`
+            bool commit(); // durable sinks, makes the temporary file durable and renames it over the target
+
+        private:
+            /********** Private Members **********/
+
+            int         _fd{-1};
+            std::byte*  _buffer{nullptr};   // page-aligned, `_capacity` bytes
+            std::size_t _capacity{0};
+            std::size_t _used{0};
+            std::size_t _total{0};
+            bool        _good{false};
+            bool        _direct{false};
+
+            // Durable sinks only.
+            std::string     _target{};      // empty unless durable
+            std::string     _temporary{};
+            commit_group*   _group{nullptr};
+        }; // class byte_sink
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_BYTE_SINK_H
@@ -0,0 +1,115 @@
+#ifndef FABER_COMMIT_GROUP_H
+#define FABER_COMMIT_GROUP_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <condition_variable>   // std::condition_variable
+#include <cstdint>              // std::uint8_t, std::uint64_t
+#include <mutex>                // std::mutex
+#include <vector>               // std::vector
+
+/********** commit_group.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /**
+         * Shares the cost of flushing files to stable storage between threads
+         * (group commit).
+         *
+         * Threads that need a file to be durable call `sync` with its descriptor. The
+         * first caller becomes the leader and flushes on behalf of every request
+         * queued up to that point, the others sleep until their request was part of a
+         * flush. Requests arriving while a flush is in progress are queued for the
+         * next one, so under load each flush covers a whole batch of files.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     io::commit_group group{};
+         *
+         *     // on any number of threads
+         *     io::write_file(path, emit, io::sink_options{ .durable = true, .group = &group });
+         * `
+         *
+         * Thread-safe. Must outlive every `sync` call.
+        */
+        class commit_group {
+        public:
+            /********** Public Types **********/
+
+            enum class strategy : std::uint8_t {
+                /**
+                 * One `syncfs` per filesystem touched by the batch, whatever the batch
+                 * size. The fastest when the filesystem isn't shared with unrelated heavy
+                 * writers, since their dirty data is flushed as well.
+                */
+                syncfs,
+
+                /**
+                 * One `fdatasync` per distinct file of the batch, a descriptor submitted
+                 * several times (typically a directory) is only flushed once.
+                */
+                fdatasync
+            };
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            explicit commit_group(strategy how = strategy::syncfs) noexcept;
+
+            commit_group(const commit_group&) = delete; // copy constructor (deleted)
+            commit_group(commit_group&&)      = delete; // move constructor (deleted)
+
+        public:
+            /********** Public Member Functions **********/
+
+            /**
+             * Blocks until the data written to `fd` so far (and, for directories, the
+             * entries created in it) is on stable storage.
+             *
+             * @returns `false` if the flush covering `fd` failed.
+            */
+            bool sync(int fd);
+
+            std::uint64_t flushes() const; // flushes performed so far, each one covering one or more `sync` calls
+            std::uint64_t requests() const; // `sync` calls so far
+
+            commit_group& operator=(const commit_group&) = delete; // copy assignment (deleted)
+            commit_group& operator=(commit_group&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Types **********/
+
+            /** A pending `sync` call, lives on its caller's stack. */
+            struct request {
+                int     fd;
+                bool    done{false};
+                bool    ok{false};
+            };
+
+            /********** Private Member Functions **********/
+
+            void flush(std::vector<request*>& batch) const; // run by the leader, without the lock
+
+        private:
+            /********** Private Members **********/
+
+            const strategy              _strategy;
+
+            mutable std::mutex          _mutex{};
+            std::condition_variable     _cv{};
+            std::vector<request*>       _pending{};
+            bool                        _flushing{false};
+            std::uint64_t               _flushes{0};
+            std::uint64_t               _requests{0};
+        }; // class commit_group
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_COMMIT_GROUP_H
@@ -0,0 +1,130 @@
+#ifndef FABER_CONCURRENT_FILE_MONITOR_H
+#define FABER_CONCURRENT_FILE_MONITOR_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <cstddef>          // std::size_t
+#include <fstream>          // file streams
+#include <functional>       // std::function, std::equal_to
+#include <initializer_list> // std::initializer_list
+#include <memory>           // std::unique_ptr
+#include <shared_mutex>     // std::shared_mutex
+#include <string>           // std::string
+#include <string_view>      // std::string_view
+#include <unordered_map>    // std::unordered_map
+#include <utility>          // std::pair
+
+// internal
+#include <file_monitor.h>
+
+/********** concurrent_file_monitor.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /**
+         * Thread-safe counterpart of `file_monitor`, meant to be shared by many worker
+         * threads without external locking.
+         *
+         * Entries are spread across independently locked shards (lock striping), so
+         * lookups only take a shared lock on a single shard and operations on
+         * different files rarely contend. Keys are owned by the monitor.
+         *
+         * Entries are allocated separately, so references to `file_info_t` and to the
+         * streams handed out by `open` stay valid until that specific file is closed,
+         * regardless of concurrent opens and closes of other files. Using a stream
+         * while another thread closes the same file is undefined, and a single stream
+         * must not be used by several threads at once without synchronization.
+        */
+        class concurrent_file_monitor {
+        public:
+            /********** Forward Declared Public Types **********/
+
+            typedef file_monitor::file_info_t file_info_t;
+
+        private:
+            /********** Private Types **********/
+
+            /** Type of initializer list for specific openmode constructor. */
+            using ilist_entry = std::pair<const char*, std::fstream::openmode>;
+
+            /** Transparent hash, allows looking up `std::string` keys by `std::string_view`. */
+            struct string_hash {
+                using is_transparent = void;
+                std::size_t operator()(std::string_view sv) const noexcept { return std::hash<std::string_view>{}(sv); }
+            };
+
+            using hashtable = std::unordered_map<std::string, file_info_t, string_hash, std::equal_to<>>;
+
+            /** A lock and the slice of the table it protects, padded to its own cache line. */
+            struct alignas(64) shard {
+                mutable std::shared_mutex   mutex{};
+                hashtable                   files{};
+            };
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            /** @param shard_count Number of shards, rounded up to a power of two. 0 picks one from the hardware concurrency. */
+            explicit concurrent_file_monitor(std::size_t shard_count = 0);
+
+            concurrent_file_monitor(std::initializer_list<const char*> ilist); // opens 1..* files (in|out)
+            concurrent_file_monitor(std::initializer_list<ilist_entry> ilist); // opens 1..* files, specify openmode for each
+
+            concurrent_file_monitor(const concurrent_file_monitor&)  = delete; // copy constructor (deleted)
+            concurrent_file_monitor(concurrent_file_monitor&&)       = delete; // move constructor (deleted)
+
+            ~concurrent_file_monitor() = default;
+
+        private:
+            /********** Private Member Functions **********/
+
+            shard& shard_for(std::size_t hash) const noexcept;
+
+            std::fstream& open_impl(const char* filename, std::fstream::openmode mode);
+
+        public:
+            /********** Public Member Functions **********/
+
+            std::fstream& open(const char* filename); // open file (in|out) and register its stream on the table
+            std::fstream& open(const char* filename, std::fstream::openmode mode); // open file (specify openmode)
+            void close(std::string_view filename); // close file and remove its stream from the table
+
+            /** Returns the entry of a registered file, or `nullptr` if it is not registered. */
+            file_info_t* find(std::string_view filename) const;
+
+            bool contains(std::string_view filename) const;
+
+            /** Same as `file_monitor::operator[] const`, throws `std::out_of_range` if not registered. */
+            file_info_t& operator[](std::string_view key) const;
+
+            std::size_t size() const; // number of registered files, a snapshot under concurrent modification
+
+            /**
+             * Invokes `fn` on every registered file. Each shard is visited under its
+             * shared lock, so `fn` must not open or close files on this monitor.
+            */
+            void for_each(const std::function<void(std::string_view, file_info_t&)>& fn) const;
+
+            concurrent_file_monitor& operator=(const concurrent_file_monitor&)   = delete; // copy assignment (deleted)
+            concurrent_file_monitor& operator=(concurrent_file_monitor&&)        = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Members **********/
+
+            // Shared by the streams of every shard (the pool is thread-safe). Declared
+            // first, streams flush into their buffer when the shards destroy them.
+            buffer_pool                 _buffers{};
+            std::size_t                 _shard_mask;
+            unsigned                    _shard_shift; // brings the hash's top bits down to pick a shard
+            std::unique_ptr<shard[]>    _shards;
+        }; // class concurrent_file_monitor
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_CONCURRENT_FILE_MONITOR_H
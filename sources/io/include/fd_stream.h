@@ -0,0 +1,305 @@
+#ifndef FABER_FD_STREAM_H
+#define FABER_FD_STREAM_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <cstddef>          // std::size_t
+#include <fstream>          // std::fstream
+#include <ios>              // std::ios_base::openmode, std::streamsize
+#include <istream>          // std::iostream
+#include <memory>           // std::unique_ptr
+#include <memory_resource>  // std::pmr::memory_resource
+#include <mutex>            // std::mutex
+#include <streambuf>        // std::streambuf
+#include <string>           // std::string
+
+// internal
+#include <file_stats.h>
+
+/********** fd_stream.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /**
+         * Recycles fixed-size I/O buffers between streams.
+         *
+         * Released buffers are kept on a free list (threaded through the buffers
+         * themselves) and handed out again, so opening and closing streams in a loop
+         * stops allocating once the pool has grown to the number of streams open at
+         * the same time. Memory comes from `upstream` and is only given back when the
+         * pool is destroyed.
+         *
+         * Thread-safe. Must outlive every stream using it.
+        */
+        class buffer_pool {
+        public:
+            static constexpr std::size_t default_buffer_size = 8 * 1024; // same as `std::filebuf`
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            explicit buffer_pool(std::size_t buffer_size = default_buffer_size,
+                                 std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+            buffer_pool(const buffer_pool&) = delete; // copy constructor (deleted)
+            buffer_pool(buffer_pool&&)      = delete; // move constructor (deleted)
+
+            ~buffer_pool(); // frees every buffer, acquired ones included
+
+        public:
+            /********** Public Member Functions **********/
+
+            char* acquire();                // a free buffer of `buffer_size()` bytes, allocated if none is left
+            void release(char* buffer);     // gives a buffer back, null is ignored
+
+            std::size_t buffer_size() const noexcept;
+            std::size_t allocated() const;  // buffers allocated so far, free or not
+
+            buffer_pool& operator=(const buffer_pool&) = delete; // copy assignment (deleted)
+            buffer_pool& operator=(buffer_pool&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Types **********/
+
+            /** Header of every buffer, links it on `_all` and, while free, on `_free`. */
+            struct node {
+                node* next_all;
+                node* next_free;
+            };
+
+        private:
+            /********** Private Members **********/
+
+            const std::size_t           _buffer_size;
+            std::pmr::memory_resource*  _upstream;
+
+            mutable std::mutex          _mutex{};
+            node*                       _all{nullptr};
+            node*                       _free{nullptr};
+            std::size_t                 _allocated{0};
+        }; // class buffer_pool
+
+        /** Process-wide `buffer_pool` of `default_buffer_size` buffers, created on first use. */
+        buffer_pool& default_buffer_pool();
+
+        /**
+         * Stream buffer reading and writing a file descriptor directly.
+         *
+         * A lighter alternative to `std::filebuf`: bytes go to the descriptor as they
+         * are (no locale conversion), the I/O buffer is borrowed from a `buffer_pool`
+         * on first use and returned on `close`, and transfers larger than the buffer
+         * bypass it. As with `std::filebuf`, a single buffer serves both directions,
+         * switching from reading to writing (or back) repositions the descriptor.
+        */
+        class fd_streambuf : public std::streambuf {
+        public:
+            /********** Constructors & Destructor **********/
+
+            explicit fd_streambuf(buffer_pool& pool = default_buffer_pool()) noexcept;
+
+            fd_streambuf(const fd_streambuf&) = delete; // copy constructor (deleted)
+            fd_streambuf(fd_streambuf&&)      = delete; // move constructor (deleted)
+
+            ~fd_streambuf() override; // flushes and closes
+
+        public:
+            /********** Public Member Functions **********/
+
+            /**
+             * Opens a file with the same `openmode` combinations as `std::filebuf`,
+             * closing the current one (if any) first. Files opened for writing are
+             * created with mode 0666 (minus the umask).
+             *
+             * @returns `this`, or `nullptr` if the file could not be opened.
+            */
+            fd_streambuf* open(const std::string& filename, std::ios_base::openmode mode);
+
+            /** Takes ownership of an open descriptor, `mode` tells which directions are allowed. */
+            fd_streambuf* attach(int fd, std::ios_base::openmode mode);
+
+            /** Flushes, closes the descriptor and returns the buffer to the pool. @returns `nullptr` on error. */
+            fd_streambuf* close();
+
+            bool is_open() const noexcept;
+            int native_handle() const noexcept; // -1 if not open
+
+            fd_streambuf& operator=(const fd_streambuf&) = delete; // copy assignment (deleted)
+            fd_streambuf& operator=(fd_streambuf&&)      = delete; // move assignment (deleted)
+
+        protected:
+            /********** std::streambuf Overrides **********/
+
+            int_type underflow() override;
+            int_type overflow(int_type ch) override;
+            int sync() override;
+
+            std::streamsize xsgetn(char_type* s, std::streamsize count) override;
+            std::streamsize xsputn(const char_type* s, std::streamsize count) override;
+
+            pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+            pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+        private:
+            /********** Private Member Functions **********/
+
+            bool ensure_buffer();   // borrows the buffer from the pool on first use
+            bool flush_put();       // writes out the put area, `false` on error
+            bool drop_get();        // discards the get area, moving the descriptor back over unread bytes
+
+        private:
+            /********** Private Members **********/
+
+            buffer_pool&            _pool;
+            char*                   _buffer{nullptr};
+            int                     _fd{-1};
+            std::ios_base::openmode _mode{};
+        }; // class fd_streambuf
+
+        /**
+         * `std::iostream` over an `fd_streambuf`, the counterpart of `std::fstream`
+         * for code that opens and closes many short-lived files.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     io::fd_stream log{"path/to/log", std::ios_base::out | std::ios_base::app};
+         *     log << "started\n";
+         * `
+         *
+         * Unlike `std::fstream`, the stream object itself allocates nothing: its
+         * buffer comes from a `buffer_pool` and is handed back on `close`.
+        */
+        class fd_stream : public std::iostream {
+        public:
+            /********** Constructors & Destructor **********/
+
+            explicit fd_stream(buffer_pool& pool = default_buffer_pool());
+            explicit fd_stream(const std::string& filename,
+                               std::ios_base::openmode mode = (std::ios_base::in | std::ios_base::out),
+                               buffer_pool& pool = default_buffer_pool());
+
+            fd_stream(const fd_stream&) = delete; // copy constructor (deleted)
+            fd_stream(fd_stream&&)      = delete; // move constructor (deleted)
+
+            ~fd_stream() override = default;
+
+        public:
+            /********** Public Member Functions **********/
+
+            void open(const std::string& filename, std::ios_base::openmode mode = (std::ios_base::in | std::ios_base::out)); // sets failbit on error
+            void close(); // sets failbit on error
+
+            bool is_open() const noexcept;
+            int native_handle() const noexcept;
+
+            fd_streambuf* rdbuf() const noexcept;
+
+            fd_stream& operator=(const fd_stream&) = delete; // copy assignment (deleted)
+            fd_stream& operator=(fd_stream&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Members **********/
+
+            mutable fd_streambuf _buf;
+        }; // class fd_stream
+
+        /**
+         * `std::fstream` using a buffer from a `buffer_pool`, where a plain stream
+         * would allocate a new one every time it is opened. Unlike `fd_stream` it is
+         * a real `std::fstream` (locale conversions included), the type stored by the
+         * file monitors. The buffer can be given back while the stream is closed, so
+         * idle streams hold none.
+         *
+         * With `record_into`, every transfer between the buffer and the file (a read
+         * refilling it, a write flushing it, or a large transfer bypassing it) is
+         * recorded as one operation on a `file_stats`. Monitors with stats enabled
+         * set it up on their streams.
+        */
+        class pooled_fstream final : public std::fstream {
+        public:
+            /********** Constructors & Destructor **********/
+
+            explicit pooled_fstream(buffer_pool& pool = default_buffer_pool()); // borrows a buffer right away
+
+            pooled_fstream(const pooled_fstream&) = delete; // copy constructor (deleted)
+            pooled_fstream(pooled_fstream&&)      = delete; // move constructor (deleted)
+
+            ~pooled_fstream() override; // flushes, closes and gives the buffer back
+
+        public:
+            /********** Public Member Functions **********/
+
+            void borrow(); // takes a buffer from the pool if none is held, must be called while closed (`setbuf` is ignored otherwise)
+            void give_back(); // returns the buffer, the stream is unbuffered until the next `borrow`, must be called while closed
+
+            /**
+             * Records the stream's transfers into `stats`, null stops recording. While
+             * recording, formatted and unformatted I/O goes through a thin layer over
+             * the file buffer (`rdbuf` still returns the file buffer itself). Data
+             * flushed by `close` is not recorded, `flush` first to count it.
+             *
+             * @param stats Counters to update, must outlive the recording.
+            */
+            void record_into(file_stats* stats);
+
+            pooled_fstream& operator=(const pooled_fstream&) = delete; // copy assignment (deleted)
+            pooled_fstream& operator=(pooled_fstream&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Types **********/
+
+            /** Forwards every call to the file buffer, timing the ones that reach the file. Holds no data itself. */
+            class recording_buf final : public std::streambuf {
+            public:
+                explicit recording_buf(std::filebuf& file) noexcept : _file(file) { }
+
+                file_stats* stats{nullptr};
+
+            protected:
+                int_type underflow() override;
+                int_type uflow() override;
+                int_type pbackfail(int_type ch) override;
+                std::streamsize showmanyc() override;
+                std::streamsize xsgetn(char_type* s, std::streamsize count) override;
+
+                int_type overflow(int_type ch) override;
+                std::streamsize xsputn(const char_type* s, std::streamsize count) override;
+                int sync() override;
+
+                pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+                pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+            private:
+                std::filebuf& _file;
+            };
+
+        private:
+            /********** Private Members **********/
+
+            buffer_pool&    _pool;
+            char*           _buffer{nullptr};
+            char            _unbuffered{};  // the filebuf can't be detached from a buffer, it points here instead
+            recording_buf   _recorder{*rdbuf()};
+        }; // class pooled_fstream
+
+        /** Destroys a `pooled_fstream` and frees it back to the resource it came from, see `make_pooled_fstream`. */
+        struct pooled_fstream_deleter {
+            std::pmr::memory_resource* resource{std::pmr::get_default_resource()};
+
+            void operator()(pooled_fstream* stream) const noexcept;
+        };
+
+        using pooled_fstream_ptr = std::unique_ptr<pooled_fstream, pooled_fstream_deleter>;
+
+        /** Allocates a `pooled_fstream` borrowing its buffers from `pool` out of `resource`. */
+        pooled_fstream_ptr make_pooled_fstream(buffer_pool& pool, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_FD_STREAM_H
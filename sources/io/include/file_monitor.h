@@ -4,18 +4,32 @@
 /********** Headers **********/
 
 // C++ stdlib
+#include <chrono>           // std::chrono::system_clock
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::uint64_t
 #include <fstream>          // file streams
+#include <string>           // std::string
 #include <string_view>      // std::string_view
+#include <tuple>            // std::tuple_size, std::tuple_element
 #include <utility>          // std::pair
-#include <memory>           // std:unique_ptr
-#include <unordered_map>    // std::unordered_map
+#include <memory>           // std::unique_ptr
+#include <memory_resource>  // std::pmr::memory_resource
 #include <initializer_list> // std::initializer_list
+#include <vector>           // std::vector
+
+// internal
+#include <fd_stream.h>
+#include <file_stats.h>
+#include <flat_table.h>
+#include <mapped_file.h>
 
 /********** file_monitor.h **********/
 
 namespace faber { inline namespace v1_0_0 {
 
     namespace io {
+
+        class file_watcher; // see file_watcher.h
         
         /** Manages and stores open files in a hash table. */
         class file_monitor {
@@ -25,15 +39,18 @@ namespace faber { inline namespace v1_0_0 {
             /** Type of initializer list for specific openmode constructor. */
             using ilist_entry = std::pair<const char*, std::fstream::openmode>;
 
-            /** Mapped type of hash table. Destructuring is supported. */
+            /**
+             * Mapped type of hash table. Destructuring is supported and yields the
+             * `stream`, `mode` and `size` members, in this order.
+            */
             struct file_info {
 
                 /********** RAII **********/
                 
                 file_info(
-                    std::unique_ptr<std::fstream>&& stream  = nullptr, 
-                    std::fstream::openmode          mode    = static_cast<std::fstream::openmode>(0), 
-                    std::uint32_t                   size    = 0U
+                    pooled_fstream_ptr&&              stream  = nullptr, 
+                    std::fstream::openmode            mode    = static_cast<std::fstream::openmode>(0), 
+                    std::uint64_t                     size    = 0U
                 ) : stream(std::move(stream)), mode(mode), size(size) { }
                 
                 /********** Rule of Five **********/
@@ -47,18 +64,45 @@ namespace faber { inline namespace v1_0_0 {
 
                 /********** Public Members **********/
                 
-                std::unique_ptr<std::fstream>   stream; /** Pointer to an open file stream on the heap. */
+                pooled_fstream_ptr              stream; /** Pointer to an open file stream on the heap, null for files registered with `file_monitor::open_mapped` only. */
                 std::fstream::openmode          mode;   /** Mode which the stream was opened with. */
-                std::uint32_t                   size;   /** Size (in byes) of the file associated to the stream. */
-                /** @todo add a timestamp of when the file was opened maybe? */
+                std::uint64_t                   size;   /** Size (in byes) of the file associated to the stream. */
+                mapped_file                     mapping{}; /** Read-only mapping of the file, see `file_monitor::open_mapped`. */
+                std::chrono::system_clock::time_point modified{}; /** Last modification time, only maintained while a `file_watcher` is attached. */
+                std::unique_ptr<file_stats>     stats{}; /** I/O counters (open time included), null unless `file_monitor::enable_stats` was called. */
+                access_hint                     hint{access_hint::normal}; /** Access pattern advised to the kernel, reapplied when an evicted stream is reopened. */
+
+                /********** Cache Bookkeeping **********/
+
+                std::streampos  position{-1};       /** Stream position saved when the stream was evicted, see `file_monitor::set_capacity`. */
+                bool            resident{false};    /** Opened by the monitor and not evicted since, counted by `file_monitor::open_streams`. */
+                file_info*      lru_prev{nullptr};  /** More recently used neighbour on the monitor's recency list. */
+                file_info*      lru_next{nullptr};  /** Less recently used neighbour on the monitor's recency list. */
+
+                /********** Destructuring **********/
+
+                template<std::size_t I>
+                auto& get() & {
+                    if constexpr (I == 0) { return stream; }
+                    else if constexpr (I == 1) { return mode; }
+                    else { return size; }
+                }
+
+                template<std::size_t I>
+                const auto& get() const & {
+                    if constexpr (I == 0) { return stream; }
+                    else if constexpr (I == 1) { return mode; }
+                    else { return size; }
+                }
             };
 
             /**
              * The underlying data structure.
              * A hash table that maps an unique filename to an object containing a 
-             * `std::fstream` associated to it and other pertinent info.
+             * `std::fstream` associated to it and other pertinent info. Filenames are
+             * copied into an arena owned by the table, see `flat_table`.
             */
-            using hashtable = std::unordered_map<std::string_view, file_info>;
+            using hashtable = flat_table<file_info>;
         
         public:
             /********** Forward Declared Public Types **********/
@@ -71,6 +115,14 @@ namespace faber { inline namespace v1_0_0 {
             
             file_monitor() = default; // default constructor
 
+            /**
+             * Allocates the table's storage (entries and filenames), the streams and
+             * their buffers from `resource`, which must outlive the monitor. A pool resource
+             * such as `std::pmr::unsynchronized_pool_resource` keeps open/close churn
+             * away from the global allocator.
+            */
+            explicit file_monitor(std::pmr::memory_resource* resource);
+
             file_monitor(std::initializer_list<const char*> ilist); // opens 1..* files (in|out)
             file_monitor(std::initializer_list<ilist_entry> ilist); // opens 1..* files, specify openmode for each
 
@@ -80,25 +132,132 @@ namespace faber { inline namespace v1_0_0 {
             ~file_monitor() = default;
 
         private:
+            friend class file_watcher;
+
             /********** Private Member Functions **********/
 
-            std::fstream& open_impl(const char* filename, std::fstream::openmode mode);
+            std::fstream& open_impl(const char* filename, std::fstream::openmode mode, access_hint hint = access_hint::normal);
+            std::fstream& acquire(std::string_view filename, file_info_t& info); // reopen if evicted, mark as most recently used
+            void open_stream(std::fstream& stream, const std::string& filename, std::fstream::openmode mode);
+
+            void lru_push_front(file_info_t& info); // no-op unless in caching mode, as `lru_unlink`
+            void lru_unlink(file_info_t& info);
+            bool evict_lru(); // closes the least recently used stream, `false` if none is open
+            void reserve_slot(); // evicts until a new stream fits within the capacity
 
         public:
             /********** Public Member Functions **********/
 
             std::fstream& open(const char* filename); // open file (in|out) and register its stream on the table
             std::fstream& open(const char* filename, std::fstream::openmode mode); // open file (specify openmode)
-            void close(std::string_view filename); // close file and remove its stream from the table
+            std::fstream& open(const char* filename, std::fstream::openmode mode, access_hint hint); // open file, advise the kernel of the access pattern (a cache hit records the new hint)
+            const mapped_file& open_mapped(const char* filename); // map file read-only, next to its stream if already opened (`open` adds one later)
+            const mapped_file& open_mapped(const char* filename, access_hint hint); // map file read-only, advise the kernel of the access pattern
+            void close(path_ref filename); // close file and remove its stream from the table
+
+            /**
+             * Advises the kernel of how a registered file is going to be accessed, with
+             * `posix_fadvise` on its stream and `madvise` on its mapping, if any. The
+             * hint is recorded on the entry either way and reapplied whenever an
+             * evicted stream is reopened.
+             *
+             * @throws std::out_of_range if `filename` is not registered.
+             *
+             * @returns `false` if the hint could not be applied to the stream or the
+             *          mapping. Streams whose descriptor is out of reach get an
+             *          approximation of the hint, and `random` can't be applied to them.
+            */
+            bool advise(path_ref filename, access_hint hint);
+
+            /**
+             * Opens a batch of files at startup, concurrently reading them into the page
+             * cache first (see `io::prefetch`) so the opens and the first reads that
+             * follow don't wait on the disk one file after another. Files already
+             * registered are skipped.
+             *
+             * Example usage: `
+             *     using namespace faber;
+             *
+             *     io::file_monitor monitor{};
+             *     monitor.warm({ "path/to/index", "path/to/data", "path/to/config" }, std::fstream::in);
+             * `
+             *
+             * @throws std::runtime_error if one of the files could not be opened, the
+             *         files before it stay registered.
+             *
+             * @param hint Access pattern advised for every file.
+             * @param threads Concurrent prefetches, 0 picks the number of hardware threads.
+             *
+             * @returns The number of files newly registered.
+            */
+            std::size_t warm(const std::vector<std::string>& paths,
+                             std::fstream::openmode mode = (std::fstream::in | std::fstream::out),
+                             access_hint hint = access_hint::sequential,
+                             std::size_t threads = 0);
 
-            /** Wrapper for unordered_map::find (const version only). */
-            hashtable_t::const_iterator find(std::string_view filename) const;
+            /** Wrapper for flat_table::find (const version only). */
+            hashtable_t::const_iterator find(path_ref filename) const;
             
-            /** Wrapper for std::unordered_map::at. */
-            const file_info_t& operator[](const std::string_view key) const;
+            /**
+             * Wrapper for flat_table::at. Files registered with `open_mapped` only have
+             * no stream, use `find` or `open_mapped` to reach their mapping.
+             *
+             * @throws std::out_of_range if `key` is not registered, std::runtime_error
+             *         if it has no stream.
+            */
+            const file_info_t& operator[](path_ref key) const;
+
+            /**
+             * Same as the const version. In caching mode, a stream evicted by the cache
+             * is transparently reopened before returning.
+             *
+             * @throws std::out_of_range if `key` is not registered, std::runtime_error
+             *         if it has no stream.
+            */
+            file_info_t& operator[](path_ref key);
 
-            /** Wrapper for std::unordered_map::operator[]. */
-            file_info_t& operator[](const std::string_view key);
+            /**
+             * Turns the monitor into a bounded handle cache.
+             *
+             * With a non-zero capacity at most `max_open` streams are kept open at once.
+             * Opening a file past that limit (or once the process runs out of file 
+             * descriptors) closes the least recently used stream, saving its position. 
+             * The stream object itself is kept, so references returned by `open` stay
+             * valid, and it is reopened with its recorded `mode` (minus `trunc`) and 
+             * position the next time it is accessed through `open` or the non-const
+             * `operator[]`. Since `out` on its own implies truncation, write-only streams
+             * are reopened with `in | out` (the file must be readable), `mode` keeps the
+             * mode the file was opened with. Opening an already registered file returns
+             * its stream instead of throwing, as long as the mode matches.
+             *
+             * Streams used directly after being evicted will report as closed, always
+             * go through the monitor when holding on to references for long. `find`,
+             * `data` and the const `operator[]` do not count as accesses.
+             *
+             * @param max_open Maximum number of open streams, 0 (the default) disables
+             *        caching. Lowering the capacity evicts streams immediately. Streams
+             *        still evicted when caching is disabled are reopened on access.
+            */
+            void set_capacity(std::size_t max_open);
+            std::size_t capacity() const noexcept;
+            std::size_t open_streams() const noexcept; // streams opened by the monitor, excludes evicted ones
+
+            /**
+             * Starts collecting I/O counters for every registered file, and every file
+             * registered from now on, see `file_stats`. Counters of a file live as long
+             * as its entry. Once enabled, counters cannot be disabled again.
+            */
+            void enable_stats();
+            bool stats_enabled() const noexcept;
+
+            /**
+             * Copies the counters of every registered file. Only reads relaxed atomics,
+             * threads recording I/O in the meantime are never blocked. Must be called
+             * from the thread that opens and closes files on the monitor.
+             *
+             * @returns Pairs of filename and counters, empty if stats are not enabled.
+            */
+            std::vector<std::pair<std::string, file_stats_snapshot>> stats_snapshot() const;
 
             const hashtable_t& data() const; // return const reference to underlying data structure, non-const version below
             hashtable_t& data();
@@ -109,7 +268,20 @@ namespace faber { inline namespace v1_0_0 {
         private:
             /********** Private Members **********/
 
-            hashtable_t _opened_files{};
+            // Stream buffers are borrowed from the pool instead of being allocated by
+            // every `std::filebuf` it opens. Declared first, streams flush into their
+            // buffer when the table destroys them.
+            std::pmr::memory_resource*  _resource{std::pmr::get_default_resource()}; // streams are allocated from it
+            buffer_pool                 _buffers{};
+            hashtable_t                 _opened_files{};
+
+            std::size_t     _capacity{0};           // 0 when not in caching mode
+            std::size_t     _open_streams{0};
+            file_info_t*    _lru_head{nullptr};     // most recently used open stream
+            file_info_t*    _lru_tail{nullptr};     // least recently used open stream, first to be evicted
+
+            file_watcher*   _watcher{nullptr};      // notified of every file registered or closed, see `file_watcher`
+            bool            _stats_enabled{false};
         }; // class file_monitor
         
     } // namespace io
@@ -117,6 +289,16 @@ namespace faber { inline namespace v1_0_0 {
 } // inline namespace v1_0_0
 } // namespace faber
 
+/********** Destructuring Support **********/
+
+template<>
+struct std::tuple_size<faber::io::file_monitor::file_info_t> : std::integral_constant<std::size_t, 3> { };
+
+template<std::size_t I>
+struct std::tuple_element<I, faber::io::file_monitor::file_info_t> {
+    using type = std::remove_reference_t<decltype(std::declval<faber::io::file_monitor::file_info_t&>().template get<I>())>;
+};
+
 #endif // FABER_FILE_MONITOR_H
 
 /** @todo make file_monitor a singleton */
@@ -0,0 +1,138 @@
+#ifndef FABER_FILE_STATS_H
+#define FABER_FILE_STATS_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::min
+#include <array>        // std::array
+#include <atomic>       // std::atomic
+#include <bit>          // std::bit_width
+#include <chrono>       // std::chrono
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t, std::int64_t
+
+/********** file_stats.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /** Number of buckets of the latency histograms, see `file_stats`. */
+        inline constexpr std::size_t latency_buckets = 32;
+
+        /**
+         * Point-in-time copy of a `file_stats`, see `file_monitor::stats_snapshot`.
+         *
+         * Bucket `i` of a latency histogram counts operations that took less than
+         * `2^i` nanoseconds (and at least `2^(i-1)`), the last bucket also counts
+         * everything slower.
+        */
+        struct file_stats_snapshot {
+            using time_point = std::chrono::system_clock::time_point;
+            using histogram  = std::array<std::uint64_t, latency_buckets>;
+
+            time_point      opened_at{};
+            time_point      last_access{};
+            std::uint64_t   accesses{0};        /** Lookups through the monitor (`open`, `operator[]`). */
+            std::uint64_t   reads{0};
+            std::uint64_t   writes{0};
+            std::uint64_t   bytes_read{0};
+            std::uint64_t   bytes_written{0};
+            histogram       read_latency{};
+            histogram       write_latency{};
+
+            /**
+             * Approximate latency percentile of a histogram, the upper bound of the
+             * bucket the `p`-th fraction (in [0, 1], clamped) of operations falls in.
+            */
+            static std::chrono::nanoseconds percentile(const histogram& h, double p) noexcept;
+        };
+
+        /**
+         * I/O counters of a single monitored file, enabled with
+         * `file_monitor::enable_stats`.
+         *
+         * Every counter is a relaxed atomic, so recording costs a handful of uncontended
+         * `fetch_add`s and never takes a lock. Counters may be updated from any thread,
+         * for instance by workers doing I/O on the monitor's behalf, and read at any
+         * time with `load`. A snapshot is not atomic as a whole: counters updated
+         * while it is taken may be off by the operations in progress.
+         *
+         * The monitor updates `accesses` and `last_access` itself. Operations made
+         * through `batch_io` or the monitor's streams are recorded automatically (see
+         * `pooled_fstream::record_into`), other ones, such as reads of a mapping, are
+         * recorded by the caller with `record`.
+        */
+        class file_stats {
+        public:
+            /********** Public Types **********/
+
+            enum class op : std::uint8_t { read, write };
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            file_stats() noexcept; // `opened_at` is now
+
+            file_stats(const file_stats&) = delete; // copy constructor (deleted)
+            file_stats(file_stats&&)      = delete; // move constructor (deleted)
+
+        public:
+            /********** Public Member Functions **********/
+
+            /** Records a completed operation of `bytes` bytes that took `latency`. */
+            void record(op kind, std::uint64_t bytes, std::chrono::nanoseconds latency) noexcept {
+                const auto ns     = static_cast<std::uint64_t>(latency.count() > 0 ? latency.count() : 0);
+                const auto bucket = std::min<std::size_t>(std::bit_width(ns), latency_buckets - 1);
+                if (kind == op::read) {
+                    _reads.fetch_add(1, std::memory_order_relaxed);
+                    _bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+                    _read_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    _writes.fetch_add(1, std::memory_order_relaxed);
+                    _bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+                    _write_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+                }
+                _last_access.store(now(), std::memory_order_relaxed);
+            }
+
+            /** Records an access without any data transfer. */
+            void touch() noexcept {
+                _accesses.fetch_add(1, std::memory_order_relaxed);
+                _last_access.store(now(), std::memory_order_relaxed);
+            }
+
+            file_stats_snapshot load() const noexcept;
+
+            file_stats& operator=(const file_stats&) = delete; // copy assignment (deleted)
+            file_stats& operator=(file_stats&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Member Functions **********/
+
+            /** Coarse clock, `last_access` doesn't need more than millisecond precision. */
+            static std::int64_t now() noexcept;
+
+        private:
+            /********** Private Members **********/
+
+            using counter = std::atomic<std::uint64_t>;
+
+            std::atomic<std::int64_t>   _opened_at{0};      // nanoseconds since the epoch
+            std::atomic<std::int64_t>   _last_access{0};    // nanoseconds since the epoch
+            counter                     _accesses{0};
+            counter                     _reads{0};
+            counter                     _writes{0};
+            counter                     _bytes_read{0};
+            counter                     _bytes_written{0};
+            std::array<counter, latency_buckets> _read_latency{};
+            std::array<counter, latency_buckets> _write_latency{};
+        }; // class file_stats
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_FILE_STATS_H
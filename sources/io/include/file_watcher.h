@@ -0,0 +1,194 @@
+#ifndef FABER_FILE_WATCHER_H
+#define FABER_FILE_WATCHER_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <chrono>           // std::chrono::system_clock
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::uint32_t, std::uint64_t
+#include <functional>       // std::function
+#include <span>             // std::span
+#include <string>           // std::string
+#include <string_view>      // std::string_view
+#include <unordered_map>    // std::unordered_map
+#include <vector>           // std::vector
+
+// internal
+#include <file_monitor.h>
+
+/********** file_watcher.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /**
+         * Keeps the metadata of the files registered on a `file_monitor` up to date,
+         * using inotify.
+         *
+         * Every file registered on the monitor (through `open` or `open_mapped`, before
+         * or after the watcher was created) is watched until it is closed. When the
+         * kernel reports a change, the file's `size` and `modified` members are
+         * refreshed with a single `stat` and an `event` is reported. Events are read in
+         * batches and coalesced, a file written a thousand times between two polls is
+         * reported once, so idle files cost nothing and busy ones cost one `stat` per
+         * poll.
+         *
+         * Renames are followed: the directory holding each file is watched as well, and
+         * once a file is renamed within (or between) watched directories its metadata
+         * is read from its new path, reported in `event::location`. The file stays
+         * registered on the monitor under its original path. A file replaced under its
+         * name (by an atomic rename, or removed and created again) is reported as
+         * `modified` and watched under the new file from then on.
+         *
+         * Events are either collected into a vector with `poll` or handed to a callback
+         * with `dispatch`. `native_handle` is readable whenever events are pending, so
+         * the watcher fits in an existing `poll`/`epoll` loop.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     io::file_monitor monitor{ "path/to/file.log" };
+         *     io::file_watcher watcher{monitor};
+         *
+         *     for (;;) {
+         *         watcher.dispatch([&monitor](std::span<const io::file_watcher::event> events) {
+         *             for (const auto& e : events) {
+         *                 if (e.mask & io::file_watcher::modified) {
+         *                     tail(monitor[e.path], e.size); // new data up to `e.size`
+         *                 }
+         *             }
+         *         }, -1);
+         *     }
+         * `
+         *
+         * Only one watcher can be attached to a monitor at a time, and the monitor must
+         * outlive it. An instance must be driven from one thread at a time, the same
+         * thread that uses the monitor.
+        */
+        class file_watcher {
+        public:
+            /********** Public Types **********/
+
+            /** Kinds of change, combined in `event::mask`. */
+            static constexpr std::uint32_t modified     = 1U << 0; /** Contents changed (written or truncated). */
+            static constexpr std::uint32_t attributes   = 1U << 1; /** Metadata changed (permissions, timestamps, links). */
+            static constexpr std::uint32_t closed_write = 1U << 2; /** A writer closed the file, a good time to reload it. */
+            static constexpr std::uint32_t removed      = 1U << 3; /** The file no longer exists at its path. */
+            static constexpr std::uint32_t moved        = 1U << 4; /** Renamed, the file is still watched at its new `location`. */
+            static constexpr std::uint32_t rescanned    = 1U << 5; /** The kernel queue overflowed, metadata was refreshed anyway. */
+
+            /** Coalesced changes of a single file since the previous poll. */
+            struct event {
+                std::string_view                        path;       /** Key on the monitor, valid until the file is closed on it. */
+                std::uint32_t                           mask;       /** Combination of the constants above. */
+                std::uint64_t                           size;       /** Size after the changes, last known one if the file was removed. */
+                std::chrono::system_clock::time_point   modified;   /** Modification time after the changes. */
+                std::string_view                        location;   /** Current path of the file, differs from `path` once renamed. Empty if moved out of sight. Valid until the next poll. */
+            };
+
+            /** Callback receiving a whole batch of events, see `dispatch`. */
+            using event_callback = std::function<void(std::span<const event>)>;
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            /**
+             * Starts watching every file currently registered on `monitor`, and every
+             * file registered on it from now on.
+             *
+             * @throws std::runtime_error if inotify is unavailable or `monitor` already
+             *         has a watcher attached.
+            */
+            explicit file_watcher(file_monitor& monitor);
+
+            file_watcher(const file_watcher&) = delete; // copy constructor (deleted)
+            file_watcher(file_watcher&&)      = delete; // move constructor (deleted)
+
+            ~file_watcher(); // detaches from the monitor and drops every watch
+
+        public:
+            /********** Public Member Functions **********/
+
+            /**
+             * Reads pending notifications, refreshes the metadata stored on the monitor
+             * and appends one event per changed file to `events`.
+             *
+             * @param timeout_ms Milliseconds to wait for a first notification, 0 returns
+             *        immediately and -1 waits indefinitely.
+             *
+             * @returns The number of events appended.
+            */
+            std::size_t poll(std::vector<event>& events, int timeout_ms = 0);
+
+            /**
+             * Same as `poll`, but hands the batch to `callback` instead. The callback is
+             * not invoked if nothing changed.
+             *
+             * @throws Any exception thrown by `callback`.
+             *
+             * @returns The number of events delivered.
+            */
+            std::size_t dispatch(const event_callback& callback, int timeout_ms = 0);
+
+            int native_handle() const noexcept; // inotify descriptor, readable while notifications are pending
+            std::size_t watched() const noexcept; // files currently watched, unwatchable files are left out
+
+            file_watcher& operator=(const file_watcher&) = delete; // copy assignment (deleted)
+            file_watcher& operator=(file_watcher&&)      = delete; // move assignment (deleted)
+
+        private:
+            friend class file_monitor;
+
+            /********** Private Member Functions **********/
+
+            void track(std::string_view filename, file_monitor::file_info_t& info);  // called by the monitor on open
+            void untrack(std::string_view filename);                                // called by the monitor on close
+            void detach(std::string_view filename, int wd); // drops the file from a watch, and the watch along with its last file
+            int rewatch(std::string_view filename); // watches the file now at its location, the new descriptor or -1 if unchanged
+
+            void refresh(std::string_view filename, std::uint32_t mask, std::vector<event>& events);
+
+            void watch_directory(std::string_view filename); // watches the directory the file currently lives in
+            void release_directory(int wd); // drops the directory's watch along with its last file
+            void relocate(int from, std::string_view from_name, int to, std::string_view to_name); // follows a rename
+            void lose(int from, std::string_view from_name); // moved to an unwatched directory
+
+        private:
+            /********** Private Types **********/
+
+            /** A watched file, followed across renames. */
+            struct watched_file {
+                int         wd;         // watch on the file itself, -1 once the kernel dropped it
+                int         directory;  // watch on the directory holding it, -1 if unknown
+                std::string location;   // current path, empty if unknown
+            };
+
+            /** A watched directory and the number of watched files it holds. */
+            struct watched_directory {
+                std::string path;
+                std::size_t files;
+            };
+
+        private:
+            /********** Private Members **********/
+
+            file_monitor&   _monitor;
+            int             _fd{-1};
+
+            // Keys are views into the monitor's path arena, removed before the monitor drops them.
+            // Hard links (or different spellings of one path) share a watch descriptor.
+            std::unordered_map<int, std::vector<std::string_view>>  _paths{};
+            std::unordered_map<std::string_view, watched_file>      _files{};
+            std::unordered_map<int, watched_directory>              _directories{};
+
+            std::vector<char>   _buffer{};
+        }; // class file_watcher
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_FILE_WATCHER_H
@@ -0,0 +1,411 @@
+#ifndef FABER_FLAT_TABLE_H
+#define FABER_FLAT_TABLE_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint32_t, std::uint64_t
+#include <deque>        // std::pmr::deque
+#include <filesystem>   // std::filesystem::path
+#include <functional>   // std::hash
+#include <iterator>     // std::forward_iterator_tag
+#include <memory_resource> // std::pmr::memory_resource
+#include <optional>     // std::optional
+#include <stdexcept>    // std::out_of_range
+#include <string>       // std::string
+#include <string_view>  // std::string_view
+#include <type_traits>  // std::conditional_t
+#include <utility>      // std::pair, std::forward
+#include <vector>       // std::pmr::vector
+
+/********** flat_table.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /**
+         * Non-owning reference to a path, used as the key argument of lookups so they
+         * accept `const char*`, `std::string`, `std::string_view` and `fs::path` alike
+         * without building a temporary string.
+        */
+        class path_ref {
+        public:
+            /********** Constructors **********/
+
+            path_ref(const char* path) noexcept : _view(path) { }
+            path_ref(const std::string& path) noexcept : _view(path) { }
+            path_ref(std::string_view path) noexcept : _view(path) { }
+            path_ref(const std::filesystem::path& path) noexcept : _view(path.native()) { }
+
+            /********** Public Member Functions **********/
+
+            std::string_view view() const noexcept { return _view; }
+            operator std::string_view() const noexcept { return _view; }
+
+        private:
+            /********** Private Members **********/
+
+            std::string_view _view;
+        }; // class path_ref
+
+        /**
+         * Bump allocator owning the bytes of interned paths.
+         *
+         * Paths are copied into large blocks and stored NUL-terminated, so an interned
+         * view can also be passed to C APIs. Every block counts its live paths and is
+         * recycled as soon as the last one is released, so memory stays bounded under
+         * open/close churn without ever moving a live path. Blocks are allocated from
+         * the memory resource given on construction.
+        */
+        class path_arena {
+        public:
+            /********** Public Types **********/
+
+            /** An interned path and the block holding it, required to release it. */
+            struct interned {
+                std::string_view    view;
+                std::uint32_t       block;
+            };
+
+            static constexpr std::size_t block_size = 16 * 1024;
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            explicit path_arena(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) noexcept;
+
+            path_arena(const path_arena&) = delete; // copy constructor (deleted)
+            path_arena(path_arena&&)      = delete; // move constructor (deleted)
+
+            ~path_arena();
+
+        public:
+            /********** Public Member Functions **********/
+
+            interned intern(std::string_view path); // copies `path` into the arena
+            void release(const interned& path);     // the view must no longer be used afterwards
+            void clear();                           // releases every path at once
+
+            std::size_t capacity() const noexcept;  // bytes reserved by all blocks
+
+            path_arena& operator=(const path_arena&) = delete; // copy assignment (deleted)
+            path_arena& operator=(path_arena&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Types **********/
+
+            struct block {
+                char*       data{nullptr};
+                std::size_t size{0};
+                std::size_t used{0};
+                std::size_t live{0};
+            };
+
+            /********** Private Member Functions **********/
+
+            char* allocate(std::size_t size);
+            void deallocate(block& b) noexcept; // frees the block's memory, leaving it empty
+
+        private:
+            /********** Private Members **********/
+
+            std::pmr::memory_resource*      _resource;
+            std::pmr::vector<block>         _blocks;
+            std::pmr::vector<std::uint32_t> _free;                // empty standard-sized blocks ready for reuse
+            std::pmr::vector<std::uint32_t> _unused;              // released oversized blocks, memory already freed
+            std::uint32_t                   _current{UINT32_MAX}; // block new paths are bumped into
+        }; // class path_arena
+
+        /**
+         * Open-addressing hash table mapping paths to values of type `T`.
+         *
+         * Keys are interned into a `path_arena` owned by the table, so the caller's
+         * strings never need to outlive their entries. Lookups probe a compact array
+         * of 8 byte slots (a 32 bit hash and an index) with linear probing, comparing
+         * hashes before touching any key, and deletions use backward shifting so no
+         * tombstones build up. Hashes are computed once, on insertion.
+         *
+         * Values are constructed in place in separate, stable storage and are never
+         * moved: `T` does not need to be copyable nor movable, and references to
+         * values (and keys) stay valid until their entry is erased. Iterators are
+         * invalidated by insertions and deletions. Iteration order is unspecified.
+         *
+         * All the table's memory (slots, values and keys) comes from the memory
+         * resource given on construction, the default resource otherwise.
+        */
+        template<typename T>
+        class flat_table {
+        public:
+            /********** Public Types **********/
+
+            /** Key-value pair, accessed through `first` and `second` like a map entry. Destructuring is supported. */
+            struct value_type {
+                template<typename... Args>
+                explicit value_type(std::string_view key, Args&&... args)
+                    : first(key), second(std::forward<Args>(args)...) { }
+
+                const std::string_view  first;
+                T                       second;
+            };
+
+        private:
+            /********** Private Types **********/
+
+            static constexpr std::uint32_t vacant = UINT32_MAX;
+
+            struct slot {
+                std::uint32_t hash{0};      // low 32 bits of the key's hash, also picks the home slot
+                std::uint32_t index{vacant}; // index into `_nodes`
+            };
+
+            struct node {
+                std::optional<value_type>   kv{};
+                std::uint32_t               block{0}; // arena block holding the key
+            };
+
+            template<bool Const>
+            class iterator_impl {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type        = flat_table::value_type;
+                using difference_type   = std::ptrdiff_t;
+                using table_type        = std::conditional_t<Const, const flat_table, flat_table>;
+                using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+                using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+
+                iterator_impl() = default;
+                iterator_impl(table_type* table, std::size_t pos) : _table(table), _pos(pos) { skip(); }
+                template<bool C> requires (Const and not C)
+                iterator_impl(const iterator_impl<C>& other) : _table(other._table), _pos(other._pos) { }
+
+                reference operator*() const { return *_table->_nodes[_table->_slots[_pos].index].kv; }
+                pointer operator->() const { return &**this; }
+
+                iterator_impl& operator++() { ++_pos; skip(); return *this; }
+                iterator_impl operator++(int) { auto tmp = *this; ++*this; return tmp; }
+
+                template<bool C>
+                bool operator==(const iterator_impl<C>& other) const noexcept { return _pos == other._pos; }
+
+            private:
+                void skip() {
+                    while (_pos < _table->_slots.size() and _table->_slots[_pos].index == vacant) { ++_pos; }
+                }
+
+                friend class flat_table;
+                template<bool> friend class iterator_impl;
+
+                table_type* _table{nullptr};
+                std::size_t _pos{0};
+            };
+
+        public:
+            using iterator          = iterator_impl<false>;
+            using const_iterator    = iterator_impl<true>;
+
+        public:
+            /********** Constructors & Destructor **********/
+
+            flat_table() = default;
+
+            /** Allocates from `resource`, which must outlive the table. */
+            explicit flat_table(std::pmr::memory_resource* resource)
+                : _slots(resource), _nodes(resource), _free_nodes(resource), _arena(resource) { }
+
+            flat_table(const flat_table&) = delete; // copy constructor (deleted)
+            flat_table(flat_table&&)      = delete; // move constructor (deleted)
+
+            ~flat_table() = default;
+
+        public:
+            /********** Lookup **********/
+
+            iterator find(path_ref key) {
+                const auto pos = locate(key.view(), hash_of(key.view()));
+                return (pos == npos) ? end() : iterator{this, pos};
+            }
+
+            const_iterator find(path_ref key) const {
+                const auto pos = locate(key.view(), hash_of(key.view()));
+                return (pos == npos) ? cend() : const_iterator{this, pos};
+            }
+
+            bool contains(path_ref key) const { return find(key) != cend(); }
+
+            T& at(path_ref key) {
+                if (const auto it = find(key); it != end()) { return it->second; }
+                throw std::out_of_range{"flat_table::at"};
+            }
+
+            const T& at(path_ref key) const {
+                if (const auto it = find(key); it != cend()) { return it->second; }
+                throw std::out_of_range{"flat_table::at"};
+            }
+
+            /** Default-constructs a value if `key` is not present. */
+            T& operator[](path_ref key) { return try_emplace(key).first->second; }
+
+            /********** Modifiers **********/
+
+            /**
+             * Constructs a value in place from `args` if `key` is not present, interning
+             * the key. Nothing is constructed if the key is already present.
+             *
+             * @returns An iterator to the entry with `key` and whether it was inserted.
+            */
+            template<typename... Args>
+            std::pair<iterator, bool> try_emplace(path_ref key, Args&&... args) {
+                const auto view = key.view();
+                const auto hash = hash_of(view);
+                if (const auto pos = locate(view, hash); pos != npos) {
+                    return {iterator{this, pos}, false};
+                }
+
+                if ((_size + 1) * 4 > _slots.size() * 3) {
+                    rehash(_slots.empty() ? 16 : _slots.size() * 2);
+                }
+
+                // Interned first, nothing else is taken if it throws. The node is
+                // given back below without allocating, whichever step fails.
+                const auto path = _arena.intern(view);
+                const bool recycled = not _free_nodes.empty();
+                std::uint32_t index{};
+                try {
+                    if (recycled) {
+                        index = _free_nodes.back();
+                        _free_nodes.pop_back();
+                    } else {
+                        index = static_cast<std::uint32_t>(_nodes.size());
+                        _nodes.emplace_back();
+                    }
+                    _nodes[index].kv.emplace(path.view, std::forward<Args>(args)...);
+                } catch (...) {
+                    _arena.release(path);
+                    if (recycled) {
+                        _free_nodes.push_back(index); // within the capacity it was popped from
+                    } else if (_nodes.size() > index) {
+                        _nodes.pop_back();
+                    }
+                    throw;
+                }
+                auto& n = _nodes[index];
+                n.block = path.block;
+
+                auto pos = home(hash);
+                while (_slots[pos].index != vacant) { pos = (pos + 1) & mask(); }
+                _slots[pos] = slot{ static_cast<std::uint32_t>(hash), index };
+                ++_size;
+                return {iterator{this, pos}, true};
+            }
+
+            /** Destroys an entry and releases its key. Invalidates all iterators. */
+            void erase(const_iterator it) {
+                auto pos = it._pos;
+                auto& n = _nodes[_slots[pos].index];
+                const auto key = n.kv->first;
+                n.kv.reset();
+                _arena.release({key, n.block});
+                _free_nodes.push_back(_slots[pos].index);
+                --_size;
+
+                // Backward shift: pull following entries of the cluster into the hole
+                // unless that would move them before their home slot.
+                for (auto next = (pos + 1) & mask(); _slots[next].index != vacant; next = (next + 1) & mask()) {
+                    const auto ideal = home(_slots[next].hash);
+                    if (((next - ideal) & mask()) >= ((next - pos) & mask())) {
+                        _slots[pos] = _slots[next];
+                        pos = next;
+                    }
+                }
+                _slots[pos] = slot{};
+            }
+
+            /** @returns The number of entries erased, 0 or 1. */
+            std::size_t erase(path_ref key) {
+                if (const auto it = find(key); it != cend()) {
+                    erase(it);
+                    return 1;
+                }
+                return 0;
+            }
+
+            void clear() {
+                _slots.assign(_slots.size(), slot{});
+                _nodes.clear();
+                _free_nodes.clear();
+                _arena.clear();
+                _size = 0;
+            }
+
+            /** Pre-sizes the slot array so that `count` entries fit without rehashing. */
+            void reserve(std::size_t count) {
+                std::size_t capacity = 16;
+                while (count * 4 > capacity * 3) { capacity *= 2; }
+                if (capacity > _slots.size()) { rehash(capacity); }
+            }
+
+            /********** Capacity & Iteration **********/
+
+            std::size_t size() const noexcept { return _size; }
+            bool empty() const noexcept { return _size == 0; }
+
+            iterator begin() { return {this, 0}; }
+            iterator end() { return {this, _slots.size()}; }
+            const_iterator begin() const { return {this, 0}; }
+            const_iterator end() const { return {this, _slots.size()}; }
+            const_iterator cbegin() const { return begin(); }
+            const_iterator cend() const { return end(); }
+
+            flat_table& operator=(const flat_table&) = delete; // copy assignment (deleted)
+            flat_table& operator=(flat_table&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Member Functions **********/
+
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+            static std::uint64_t hash_of(std::string_view key) noexcept { return std::hash<std::string_view>{}(key); }
+
+            std::size_t mask() const noexcept { return _slots.size() - 1; }
+            std::size_t home(std::uint64_t hash) const noexcept { return static_cast<std::uint32_t>(hash) & mask(); }
+
+            std::size_t locate(std::string_view key, std::uint64_t hash) const {
+                if (_size == 0) { return npos; }
+                const auto hash32 = static_cast<std::uint32_t>(hash);
+                for (auto pos = home(hash); _slots[pos].index != vacant; pos = (pos + 1) & mask()) {
+                    if (_slots[pos].hash == hash32 and _nodes[_slots[pos].index].kv->first == key) {
+                        return pos;
+                    }
+                }
+                return npos;
+            }
+
+            void rehash(std::size_t capacity) {
+                std::pmr::vector<slot> old{std::move(_slots)};
+                _slots.assign(capacity, slot{});
+                for (const auto& s : old) {
+                    if (s.index == vacant) { continue; }
+                    auto pos = home(s.hash);
+                    while (_slots[pos].index != vacant) { pos = (pos + 1) & mask(); }
+                    _slots[pos] = s;
+                }
+            }
+
+        private:
+            /********** Private Members **********/
+
+            std::pmr::vector<slot>          _slots{};       // power of two sized, at most 3/4 full
+            std::pmr::deque<node>           _nodes{};       // stable storage, never reallocated
+            std::pmr::vector<std::uint32_t> _free_nodes{};  // indices of erased nodes ready for reuse
+            path_arena                      _arena{};
+            std::size_t                 _size{0};
+        }; // class flat_table
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_FLAT_TABLE_H
@@ -12,9 +12,18 @@
 #include <vector> 		// std::vector
 #include <functional> 	// function objects
 #include <concepts> 	// concepts library
+#include <span> 		// std::span
+#include <cstddef> 		// std::byte
 
 // internal
+#include <byte_sink.h>
+#include <commit_group.h>
+#include <fd_stream.h>
 #include <file_monitor.h>
+#include <file_watcher.h>
+#include <mapped_file.h>
+#include <metadata.h>
+#include <records.h>
 
 /********** io.h **********/
 
@@ -99,6 +108,48 @@ namespace faber { inline namespace v1_0_0 {
             return impl_details::file_io_cllbck_impl(filename, callback, mode |= std::fstream::in);
         }
 
+        /**
+         * Memory-mapped counterpart of `io::read_file`. Maps the whole file into memory
+         * and invokes a user-defined callable with a read-only view over its contents,
+         * allowing the data to be parsed in place without being copied into a stream
+         * buffer. The file is unmapped immediately after invoking the function.
+         * 
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         * 
+         *     std::size_t lines = 0;
+         *     const auto count_lines = [&lines](std::span<const std::byte> bytes) -> bool {
+         *         lines = std::ranges::count(bytes, std::byte{'\n'});
+         *         return true;
+         *     };
+         * 
+         *     io::read_file("path/to/file"s, count_lines);
+         * `
+         * 
+         * @throws May throw any exception caused by the provided callback function.
+         *
+         * @param filename Path to an existing file.
+         * @param callback A callable object or function that takes a
+         *        `std::span<const std::byte>` over the contents of the file as its only
+         *        argument and returns `true` if its operations succeed or `false`
+         *        otherwise. The span is only valid for the duration of the call and is
+         *        empty if the file is empty.
+         *
+         * @returns A boolean, the same value returned by the callback function, or
+         *          `false` if the file could not be mapped.
+        */
+        template<typename Invocable>
+        requires std::invocable<Invocable, std::span<const std::byte>>
+        bool
+        read_file(const std::string& filename, Invocable&& callback) {
+            if (const mapped_file file{filename}; file.is_open()) {
+                return std::invoke(callback, file.bytes());
+            }
+            std::cerr << "[ERROR] Failed to map file `" << filename << "`\n";
+            return false;
+        }
+
         /**
          * Implements boilerplate code for opening and closing a file for writing with 
          * basic error handling, then invokes a user-defined callable that performs the 
@@ -145,6 +196,70 @@ namespace faber { inline namespace v1_0_0 {
             return impl_details::file_io_cllbck_impl(filename, callback, mode |= (std::fstream::out | std::fstream::trunc));
         }
 
+        /**
+         * Byte-sink counterpart of `io::write_file`. Opens (and truncates) a file for
+         * writing through an `io::byte_sink` and invokes a user-defined callable that
+         * performs the write operations on it. The sink is flushed and the file closed
+         * immediately after invoking the function.
+         * 
+         * Skips iostream formatting and the stream's small default buffer entirely,
+         * output goes through a large page-aligned buffer flushed with `write`/`writev`
+         * (optionally with `O_DIRECT`, see `io::sink_options`).
+         * 
+         * With `sink_options::durable` the file is not truncated: the output goes to a
+         * temporary sibling that atomically replaces it once complete and flushed to
+         * stable storage, so a crash never leaves a torn file behind. Pass a shared
+         * `io::commit_group` in `sink_options::group` when many threads write durable
+         * files at once, so they share the flushes.
+         * 
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         * 
+         *     const auto emit = [](io::byte_sink& out) -> bool {
+         *         for (const auto& record : records) {
+         *             out.write(record);
+         *             out.put('\n');
+         *         }
+         *         return out.good();
+         *     };
+         * 
+         *     // last argument is optional
+         *     io::write_file("path/to/file"s, emit, io::sink_options{ .buffer_size = 8 << 20, .direct = true });
+         *
+         *     // crash-safe checkpoint, flushes shared with other threads using `group`
+         *     io::write_file("path/to/checkpoint"s, emit, io::sink_options{ .durable = true, .group = &group });
+         * `
+         * 
+         * @throws May throw any exception caused by the provided callback function. In
+         *         durable mode the file is then left untouched.
+         *
+         * @param filename Path to a file. The file will be truncated if it already exists
+         *        (replaced once complete in durable mode).
+         * @param callback A callable object or function that takes a reference to an
+         *        open `io::byte_sink` as its only argument and returns `true` if its
+         *        operations succeed or `false` otherwise. The callback must NOT close
+         *        the sink. In durable mode, returning `false` leaves the file untouched.
+         * @param options Buffer size, `O_DIRECT` and durable modes of the sink.
+         *
+         * @returns `true` if the callback returned `true` and every byte was written 
+         *          out successfully, `false` otherwise.
+        */
+        template<typename Invocable>
+        requires (not std::invocable<Invocable, std::fstream&> and std::invocable<Invocable, byte_sink&>)
+        bool
+        write_file(const std::string& filename, Invocable&& callback, const sink_options& options = {}) {
+            if (byte_sink sink{filename, options}; sink.is_open()) {
+                if (not std::invoke(callback, sink)) {
+                    sink.discard(); // a durable write leaves the target untouched
+                    return false;
+                }
+                return sink.close();
+            }
+            std::cerr << "[ERROR] Failed to open file `" << filename << "`\n";
+            return false;
+        }
+
         /**
          * Implements boilerplate code for opening and closing a file with basic error 
          * handling, then invokes a user-defined callable that performs I/O operations on
@@ -200,58 +315,163 @@ namespace faber { inline namespace v1_0_0 {
          * @returns `true` if the directory(ies) were created, `false` otherwise.
         */
         bool
-        try_mkdirs(const fs::path& dir) {
-            std::error_code ec{};
-            if (not fs::create_directories(dir, ec)) {
-                std::cerr <<
-                    "[ERROR] Failed to create directory(ies)\n"
-                    "\tReason: " << ec.message() << "\n"
-                << std::endl;
-                return false;
-            }
-            return true;
+        try_mkdirs(const fs::path& dir);
+
+        /** Tuning knobs for `io::copy_file` and `io::transfer`. */
+        struct copy_options {
+            /** Replace the destination if it exists, otherwise fail. */
+            bool overwrite = true;
+
+            /** Try a reflink (`FICLONE`) first: instant, shares blocks copy-on-write. */
+            bool reflink = true;
+
+            /** Files at least this large are copied as several chunks in parallel. */
+            std::size_t parallel_threshold = 256 * 1024 * 1024;
+
+            /** Size of each chunk of a parallel copy. */
+            std::size_t chunk_size = 64 * 1024 * 1024;
+
+            /** Workers of a parallel copy, 0 picks the number of hardware threads. */
+            std::size_t threads = 0;
         };
 
         /**
-         * Returns the size (in bytes) of a file loaded in memory.
+         * Copies a regular file without moving its contents through user space.
+         *
+         * A reflink is attempted first, which on filesystems supporting it (Btrfs, XFS,
+         * bcachefs...) completes instantly whatever the size. Otherwise the data is
+         * copied in the kernel with `copy_file_range` (server-side on network
+         * filesystems), falling back to `sendfile` and, as a last resort, to
+         * `pread`/`pwrite`. Files above `copy_options::parallel_threshold` are split in
+         * chunks copied concurrently. Directories leading to `to` are created as needed
+         * and the permissions of `from` are set on `to`, whether it is created or
+         * overwritten. If the copy fails, a destination created by the call is removed,
+         * an existing one is kept (its contents may then be incomplete).
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     io::copy_file("path/to/data.bin", "path/to/backup/data.bin");
+         * `
+         *
+         * @param from Path to an existing regular file.
+         * @param to Path of the copy.
+         * @param options See `io::copy_options`.
+         *
+         * @returns `true` if the whole file was copied, `false` otherwise.
+        */
+        bool
+        copy_file(const fs::path& from, const fs::path& to, const copy_options& options = {});
+
+        /**
+         * Moves a file. A plain `rename` when both paths are on the same filesystem,
+         * otherwise `io::copy_file` followed by the removal of `from`. The copy is also
+         * used when `overwrite` is off and the filesystem can't rename without
+         * replacing. Directories leading to `to` are created as needed.
+         *
+         * @param from Path to an existing regular file.
+         * @param to New path of the file.
+         * @param options See `io::copy_options`, `overwrite` applies to the rename too.
+         *
+         * @returns `true` if the file was moved, `false` otherwise (`from` is kept).
+        */
+        bool
+        transfer(const fs::path& from, const fs::path& to, const copy_options& options = {});
+
+        /**
+         * Returns the size (in bytes) of a file loaded in memory. Output still
+         * buffered by the stream is flushed first and counts towards the size, the
+         * stream's position and read buffer are left untouched.
          *
          * @param file Stream associated with a file.
          *
          * @returns The size of the file in bytes.
         */
         std::size_t
-        filesize(std::fstream& file) {
-            const auto cur = file.tellg();
+        filesize(std::fstream& file);
 
-            file.seekg(0, file.end);
-            const auto size = file.tellg();
+        /**
+         * Returns the size (in bytes) of a file on disk. Queries the filesystem
+         * metadata with a single `stat` call, the file is never opened.
+         *
+         * @param filename Path to a file.
+         *
+         * @returns The size of the file in bytes or 0 if the file doesn't exist.
+        */
+        std::size_t
+        filesize(const std::string& filename);
+
+        /**
+         * Reads the whole contents of a file into a string. The file is opened once,
+         * its size is taken from a single `fstat` call and the string is resized to 
+         * fit it before reading, so no other allocations are performed.
+         * 
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         * 
+         *     std::string config{};
+         *     if (io::read_all("path/to/file"s, config)) {
+         *         parse(config);
+         *     }
+         * `
+         *
+         * @param filename Path to an existing file.
+         * @param out String to read into. Its previous contents are replaced and its
+         *        size is set to the number of bytes actually read.
+         *
+         * @returns `true` if the whole file was read, `false` otherwise.
+        */
+        bool
+        read_all(const std::string& filename, std::string& out);
 
-            file.seekg(cur);
+        /**
+         * Reads the whole contents of a file into a byte vector. Behaves exactly like 
+         * the `std::string` overload of `io::read_all`.
+         *
+         * @param filename Path to an existing file.
+         * @param out Vector to read into. Its previous contents are replaced and its
+         *        size is set to the number of bytes actually read.
+         *
+         * @returns `true` if the whole file was read, `false` otherwise.
+        */
+        bool
+        read_all(const std::string& filename, std::vector<std::byte>& out);
 
-            return size;
-        };
+        /**
+         * Reads the whole contents of a file into a caller-supplied buffer. No memory
+         * is allocated, the file is opened once and its size is taken from a single 
+         * `fstat` call.
+         *
+         * @param filename Path to an existing file.
+         * @param buffer Destination buffer, must be at least as large as the file.
+         * @param bytes_read Set to the number of bytes written to `buffer`.
+         *
+         * @returns `true` if the whole file was read, `false` if it could not be read
+         *          or does not fit in `buffer`.
+        */
+        bool
+        read_into(const std::string& filename, std::span<std::byte> buffer, std::size_t& bytes_read);
 
         /**
-         * Returns the size (in bytes) of a file on disk.
+         * Warms the page cache with the contents of a set of files, so reading them
+         * afterwards doesn't wait on the disk. Files are opened and their readahead
+         * started concurrently on several threads, which keeps a cold device busy
+         * with many requests at once instead of one file at a time.
          *
-         * @param filename Path to a file.
+         * Example usage: `
+         *     using namespace faber;
          *
-         * @returns The size of the file in bytes or 0 if the file doesn't exist.
+         *     io::prefetch({ "path/to/index", "path/to/data" });
+         * `
+         *
+         * @param paths Files to prefetch, missing ones are skipped.
+         * @param threads Number of threads, 0 picks the number of hardware threads.
+         *
+         * @returns The number of files prefetched.
         */
         std::size_t
-        filesize(const std::string& filename) {
-            using namespace faber::io;
-
-            // prevents std::fstream constructor from creating file down the road
-            if ( not fs::exists(filename) ) { return 0; }
-
-            size_t size = 0;
-            read_file(filename, [&size](std::fstream& file) -> bool {
-                size = file.tellg();
-                return true;
-            }, std::fstream::ate);
-            return size;
-        };
+        prefetch(const std::vector<std::string>& paths, std::size_t threads = 0);
 
     } // namespace io
 
@@ -262,4 +482,3 @@ namespace faber { inline namespace v1_0_0 {
 
 /** @todo add open_file_then overload that doesn't close the file after operation */
 /** @todo refector header to only forward-declare types and functions */
-/** @todo move implementation of non-template functions to a separate translation unit */
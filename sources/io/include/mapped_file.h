@@ -0,0 +1,92 @@
+#ifndef FABER_MAPPED_FILE_H
+#define FABER_MAPPED_FILE_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <cstddef>      // std::byte, std::size_t
+#include <cstdint>      // std::uint8_t
+#include <span>         // std::span
+#include <string>       // std::string
+
+/********** mapped_file.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /**
+         * Expected access pattern of a file's contents, passed on to the kernel with
+         * `posix_fadvise` (streams) or `madvise` (mappings) to tune readahead and
+         * caching.
+        */
+        enum class access_hint : std::uint8_t {
+            normal,     /** Default readahead. */
+            sequential, /** Read front to back, readahead is made more aggressive. */
+            random,     /** Scattered reads, readahead is disabled. */
+            willneed,   /** The whole file will be needed soon, reading it in starts in the background. */
+            dontneed    /** The cached contents won't be needed, the kernel may drop them. */
+        };
+
+        /**
+         * RAII handle to a read-only, private memory mapping of a whole file.
+         *
+         * The contents are exposed as a contiguous `std::span<const std::byte>` that
+         * points directly into the page cache, so no copies are made when reading.
+         * The mapping is released when the object is destroyed or `close` is called,
+         * which invalidates every span previously obtained from it.
+        */
+        class mapped_file {
+        public:
+            /********** Constructors & Destructor **********/
+
+            mapped_file() = default; // default constructor, not associated to any file
+
+            explicit mapped_file(const std::string& filename); // maps `filename`, check `is_open` afterwards
+
+            mapped_file(const mapped_file&) = delete;   // copy constructor (deleted)
+            mapped_file(mapped_file&& other) noexcept;  // move constructor
+
+            ~mapped_file();
+
+        public:
+            /********** Public Member Functions **********/
+
+            /**
+             * Maps a file into memory, releasing the current mapping (if any) first.
+             *
+             * @param filename Path to an existing file.
+             *
+             * @returns `true` if the file was mapped, `false` otherwise.
+            */
+            bool open(const std::string& filename);
+
+            void close(); // unmaps the file, no-op if not open
+
+            bool is_open() const noexcept;
+
+            const std::byte* data() const noexcept; // pointer to the first byte, `nullptr` if empty or not open
+            std::size_t size() const noexcept;      // size (in bytes) of the mapped file
+
+            /** Returns a view over the whole mapping. Empty if the file is empty or not open. */
+            std::span<const std::byte> bytes() const noexcept;
+
+            bool advise(access_hint hint) const noexcept; // `madvise` over the whole mapping, `true` if empty
+
+            mapped_file& operator=(const mapped_file&) = delete;    // copy assignment (deleted)
+            mapped_file& operator=(mapped_file&& other) noexcept;   // move assignment
+
+        private:
+            /********** Private Members **********/
+
+            const std::byte* _data{nullptr};
+            std::size_t      _size{0};
+            bool             _open{false};
+        }; // class mapped_file
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_MAPPED_FILE_H
@@ -0,0 +1,148 @@
+#ifndef FABER_METADATA_H
+#define FABER_METADATA_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <chrono>       // std::chrono::system_clock
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t
+#include <filesystem>   // std::filesystem::file_type
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+// internal
+#include <flat_table.h>
+
+/********** metadata.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /** Metadata of a single path, see `io::stat_files` and `metadata_cache`. */
+        struct file_metadata {
+            using time_point = std::chrono::system_clock::time_point;
+
+            std::uint64_t               size{0};
+            time_point                  modified{};
+            std::uint64_t               inode{0};
+            std::uint64_t               device{0};  /** Together with `inode`, identifies the file. */
+            std::filesystem::file_type  type{std::filesystem::file_type::none};
+            int                         error{0};   /** `errno` of the failed query (`type` is then `not_found` or `none`), 0 on success. */
+
+            bool exists() const noexcept { return error == 0; }
+        };
+
+        /**
+         * Queries the size, modification time, inode and type of many paths at once
+         * with `statx`, asking only for those fields. The batch is spread over several
+         * threads, so a cold cache or a network filesystem serves many lookups in
+         * parallel instead of one path after another. Symbolic links are followed.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     const auto metadata = io::stat_files({ "path/to/a", "path/to/b" });
+         *     for (const auto& m : metadata) {
+         *         if (m.exists() and m.type == io::fs::file_type::regular) {
+         *             total += m.size;
+         *         }
+         *     }
+         * `
+         *
+         * @param threads Number of threads, 0 picks the number of hardware threads.
+         *        Small batches use fewer threads.
+         *
+         * @returns The metadata of every path, in the same order as `paths`. Paths
+         *          listed more than once are queried once.
+        */
+        std::vector<file_metadata>
+        stat_files(const std::vector<std::string>& paths, std::size_t threads = 0);
+
+        /**
+         * Cache of path metadata, filled in batches with `io::stat_files`.
+         *
+         * Scans that look the same paths up again and again (inventories, build
+         * tools, sync jobs) query the filesystem once per path, then read the cached
+         * copy. Entries never expire on their own: `refresh` queries paths again and
+         * `invalidate` drops them, typically when a `file_watcher` reports a change.
+         * Failed queries are cached as well, a missing file stays missing until
+         * refreshed or invalidated.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     io::metadata_cache cache{};
+         *     cache.fetch(paths); // one parallel batch
+         *     for (const auto& path : paths) {
+         *         if (cache.get(path).modified > last_run) {
+         *             rebuild(path);
+         *         }
+         *     }
+         * `
+         *
+         * Not thread-safe. References returned by `get` and `find` stay valid until
+         * their entry is invalidated.
+        */
+        class metadata_cache {
+        public:
+            /********** Constructors & Destructor **********/
+
+            /** @param threads Threads used by batched queries, 0 picks the number of hardware threads. */
+            explicit metadata_cache(std::size_t threads = 0) noexcept;
+
+            metadata_cache(const metadata_cache&) = delete; // copy constructor (deleted)
+            metadata_cache(metadata_cache&&)      = delete; // move constructor (deleted)
+
+            ~metadata_cache() = default;
+
+        public:
+            /********** Public Member Functions **********/
+
+            /**
+             * Queries, in a single batch, every path of `paths` that isn't cached yet.
+             *
+             * @returns The number of distinct paths queried.
+            */
+            std::size_t fetch(const std::vector<std::string>& paths);
+
+            /**
+             * Queries every path of `paths` again, cached or not, in a single batch.
+             *
+             * @returns The number of distinct paths queried.
+            */
+            std::size_t refresh(const std::vector<std::string>& paths);
+
+            /** Cached metadata of `path`, queried on its own first if missing. */
+            const file_metadata& get(path_ref path);
+
+            /** Cached metadata of `path`, `nullptr` if missing. Never queries. */
+            const file_metadata* find(path_ref path) const;
+
+            bool invalidate(path_ref path); // drops the entry of `path`, `false` if it wasn't cached
+            void invalidate();              // drops every entry
+
+            std::size_t size() const noexcept; // number of cached paths
+
+            metadata_cache& operator=(const metadata_cache&) = delete; // copy assignment (deleted)
+            metadata_cache& operator=(metadata_cache&&)      = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Member Functions **********/
+
+            std::size_t store(const std::vector<std::string>& paths, bool missing_only);
+
+        private:
+            /********** Private Members **********/
+
+            flat_table<file_metadata>   _entries{};
+            std::size_t                 _threads;
+        }; // class metadata_cache
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_METADATA_H
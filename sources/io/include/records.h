@@ -0,0 +1,269 @@
+#ifndef FABER_RECORDS_H
+#define FABER_RECORDS_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <concepts>     // std::invocable, std::convertible_to
+#include <cstddef>      // std::size_t
+#include <functional>   // std::invoke
+#include <iostream>     // std::cerr
+#include <optional>     // std::optional
+#include <string>       // std::string
+#include <string_view>  // std::string_view
+#include <type_traits>  // std::invoke_result_t, std::remove_reference_t, std::is_void_v
+#include <utility>      // std::forward, std::move
+#include <vector>       // std::vector
+
+// internal
+#include <mapped_file.h>
+#include <thread_pool.h>
+
+/********** records.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /** Implementation details, see API section for user-facing interface. */
+        namespace impl_details {
+
+            /** Type-erased record callback: returns `false` to stop scanning. */
+            using record_sink = bool (*)(void* context, std::string_view record);
+
+            /**
+             * Reads `filename` in large blocks and invokes `sink` for every record
+             * terminated by `delimiter` (the delimiter itself excluded), plus a trailing
+             * record not followed by one, if any. Delimiters are located with SSE2/AVX2
+             * when available, records crossing a block boundary are reassembled.
+             *
+             * @returns `true` if the whole file was scanned, `false` if it could not be
+             *          read or `sink` stopped the scan.
+            */
+            bool
+            scan_records(const std::string& filename, char delimiter, std::size_t block_size, record_sink sink, void* context);
+
+            /**
+             * Returns a pointer to the first occurrence of `delimiter` in `[first, last)`,
+             * or `last` if there is none. Vectorized, dispatched at runtime.
+            */
+            const char*
+            find_delimiter(const char* first, const char* last, char delimiter) noexcept;
+
+            /**
+             * Splits `data` into consecutive ranges of roughly `chunk_size` bytes. Every
+             * range but the last ends right after a `delimiter`, so no record is cut in
+             * two. Empty data gives a single empty range.
+            */
+            std::vector<std::string_view>
+            split_records(std::string_view data, std::size_t chunk_size, char delimiter);
+
+        } // namespace impl_details
+
+        /********** API  **********/
+
+        /** Default size (in bytes) of the blocks read by `io::for_each_record`. */
+        inline constexpr std::size_t default_record_block_size = 1024 * 1024;
+
+        /**
+         * Invokes a user-defined callable for every record of a file, records being
+         * separated by `delimiter`. Replaces a `std::getline` loop inside an
+         * `io::read_file` callback: the file is read in large blocks, delimiters are
+         * located with vectorized scanning and records are handed to the callback as
+         * views into the block, so no allocation is made per record.
+         *
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         *
+         *     std::size_t fields = 0;
+         *     io::for_each_record("path/to/file.csv"s, ',', [&fields](std::string_view) {
+         *         ++fields;
+         *     });
+         * `
+         *
+         * @throws Any exception caused by the provided callback function.
+         *
+         * @param filename Path to an existing file.
+         * @param delimiter Record separator, not included in the records.
+         * @param callback A callable object or function that takes a `std::string_view`
+         *        over a single record. The view is only valid for the duration of the
+         *        call. If it returns something convertible to `bool`, returning `false`
+         *        stops the scan.
+         * @param block_size Size of the blocks the file is read in. Grown as needed
+         *        if a single record doesn't fit.
+         *
+         * @returns `true` if the whole file was scanned, `false` if it could not be
+         *          read or the callback stopped the scan.
+        */
+        template<typename Invocable>
+        requires std::invocable<Invocable, std::string_view>
+        bool
+        for_each_record(const std::string& filename, char delimiter, Invocable&& callback, std::size_t block_size = default_record_block_size) {
+            using callable = std::remove_reference_t<Invocable>;
+            const auto sink = [](void* context, std::string_view record) -> bool {
+                auto& fn = *static_cast<callable*>(context);
+                if constexpr (std::convertible_to<std::invoke_result_t<callable&, std::string_view>, bool>) {
+                    return static_cast<bool>(std::invoke(fn, record));
+                } else {
+                    std::invoke(fn, record);
+                    return true;
+                }
+            };
+            return impl_details::scan_records(filename, delimiter, block_size, sink, const_cast<void*>(static_cast<const void*>(&callback)));
+        }
+
+        /**
+         * Invokes a user-defined callable for every line of a file. Same as
+         * `io::for_each_record` with `'\n'` as the delimiter. Like `std::getline`,
+         * carriage returns are kept.
+         *
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         *
+         *     io::for_each_line("path/to/file"s, [](std::string_view line) {
+         *         std::cout << line << '\n';
+         *     });
+         * `
+         *
+         * @returns `true` if the whole file was scanned, `false` if it could not be
+         *          read or the callback stopped the scan.
+        */
+        template<typename Invocable>
+        requires std::invocable<Invocable, std::string_view>
+        bool
+        for_each_line(const std::string& filename, Invocable&& callback, std::size_t block_size = default_record_block_size) {
+            return for_each_record(filename, '\n', std::forward<Invocable>(callback), block_size);
+        }
+
+        /**
+         * Processes a single large file on several cores. The file is mapped into
+         * memory and split into ranges of roughly `chunk_size` bytes, each range
+         * boundary being moved forward past the next `delimiter` so no record is cut
+         * in two. Ranges are handed to the callback concurrently from a pool of
+         * threads (the calling one included), in no particular order.
+         *
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         *
+         *     std::atomic<std::size_t> errors{0};
+         *     io::parallel_read_file("path/to/huge.log"s, 64 << 20, [&errors](std::string_view chunk) {
+         *         errors += count_errors(chunk);
+         *     });
+         * `
+         *
+         * @throws The first exception thrown by the callback, once every thread stopped.
+         *
+         * @param filename Path to an existing file.
+         * @param chunk_size Target size of a range, ranges are larger when a record
+         *        crosses the nominal boundary.
+         * @param callback A thread-safe callable taking a `std::string_view` over a
+         *        range of whole records, delimiters included. The view is valid for the
+         *        duration of the call only. If it returns something convertible to
+         *        `bool`, returning `false` stops handing out ranges.
+         * @param delimiter Record separator.
+         * @param threads Number of threads, 0 picks the number of hardware threads.
+         *
+         * @returns `true` if every range was processed, `false` if the file could not
+         *          be mapped or the callback stopped the processing.
+        */
+        template<typename Invocable>
+        requires std::invocable<Invocable&, std::string_view>
+        bool
+        parallel_read_file(const std::string& filename, std::size_t chunk_size, Invocable&& callback, char delimiter = '\n', std::size_t threads = 0) {
+            const mapped_file file{filename};
+            if (not file.is_open()) {
+                std::cerr << "[ERROR] Failed to map file `" << filename << "`\n";
+                return false;
+            }
+            file.advise(access_hint::sequential);
+
+            struct context_type {
+                std::vector<std::string_view>       ranges;
+                std::remove_reference_t<Invocable>& fn;
+            } context{
+                impl_details::split_records({ reinterpret_cast<const char*>(file.data()), file.size() }, chunk_size, delimiter),
+                callback
+            };
+
+            const auto task = [](void* ctx, std::size_t index) -> bool {
+                auto& c = *static_cast<context_type*>(ctx);
+                if constexpr (std::convertible_to<std::invoke_result_t<decltype(c.fn), std::string_view>, bool>) {
+                    return static_cast<bool>(std::invoke(c.fn, c.ranges[index]));
+                } else {
+                    std::invoke(c.fn, c.ranges[index]);
+                    return true;
+                }
+            };
+            return impl_details::run_chunks(context.ranges.size(), threads, task, &context);
+        }
+
+        /**
+         * Map-reduce flavour of `io::parallel_read_file`. Every range is mapped to a
+         * partial result concurrently, then the partial results are folded with
+         * `reduce` on the calling thread, in file order, so `reduce` needs to be
+         * associative but not commutative nor thread-safe.
+         *
+         * Example usage: `
+         *     using namespace std::string_literals;
+         *     using namespace faber;
+         *
+         *     const auto lines = io::parallel_read_file("path/to/huge.csv"s, 64 << 20,
+         *         [](std::string_view chunk) { return std::ranges::count(chunk, '\n'); },
+         *         std::plus<>{});
+         * `
+         *
+         * @throws The first exception thrown by `map` or `reduce`.
+         *
+         * @param map A thread-safe callable taking a `std::string_view` over a range of
+         *        whole records and returning its partial result.
+         * @param reduce A callable combining two partial results into one.
+         *
+         * @returns The combined result, `std::nullopt` if the file could not be mapped.
+         *          An empty file is mapped as a single empty range.
+        */
+        template<typename Map, typename Reduce, typename Result = std::invoke_result_t<Map&, std::string_view>>
+        requires (std::invocable<Map&, std::string_view> and not std::is_void_v<Result>
+                  and std::invocable<Reduce&, Result, Result>)
+        std::optional<Result>
+        parallel_read_file(const std::string& filename, std::size_t chunk_size, Map&& map, Reduce&& reduce, char delimiter = '\n', std::size_t threads = 0) {
+            const mapped_file file{filename};
+            if (not file.is_open()) {
+                std::cerr << "[ERROR] Failed to map file `" << filename << "`\n";
+                return std::nullopt;
+            }
+            file.advise(access_hint::sequential);
+
+            struct context_type {
+                std::vector<std::string_view>       ranges;
+                std::vector<std::optional<Result>>  partials;
+                std::remove_reference_t<Map>&       fn;
+            } context{
+                impl_details::split_records({ reinterpret_cast<const char*>(file.data()), file.size() }, chunk_size, delimiter),
+                {},
+                map
+            };
+            context.partials.resize(context.ranges.size());
+
+            const auto task = [](void* ctx, std::size_t index) -> bool {
+                auto& c = *static_cast<context_type*>(ctx);
+                c.partials[index].emplace(std::invoke(c.fn, c.ranges[index]));
+                return true;
+            };
+            impl_details::run_chunks(context.ranges.size(), threads, task, &context);
+
+            Result result = std::move(*context.partials.front());
+            for (std::size_t i = 1; i < context.partials.size(); ++i) {
+                result = std::invoke(reduce, std::move(result), std::move(*context.partials[i]));
+            }
+            return result;
+        }
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_RECORDS_H
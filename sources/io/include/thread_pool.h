@@ -0,0 +1,88 @@
+#ifndef FABER_THREAD_POOL_H
+#define FABER_THREAD_POOL_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <condition_variable>   // std::condition_variable_any
+#include <cstddef>              // std::size_t
+#include <deque>                // std::deque
+#include <functional>           // std::function
+#include <mutex>                // std::mutex
+#include <stop_token>           // std::stop_token
+#include <thread>               // std::jthread
+#include <vector>               // std::vector
+
+/********** thread_pool.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /** Implementation details, see API section for user-facing interface. */
+        namespace impl_details {
+
+            /** Type-erased chunk task: processes chunk `index`, returns `false` to stop. */
+            using chunk_task = bool (*)(void* context, std::size_t index);
+
+            /**
+             * Runs `task` for every index in `[0, count)` on `threads` threads, the
+             * calling one included (0 picks the number of hardware threads). No more chunks are handed out once a task returns
+             * `false` or throws, the first exception is rethrown on the calling thread.
+             *
+             * @returns `false` if a task returned `false`.
+            */
+            bool
+            run_chunks(std::size_t count, std::size_t threads, chunk_task task, void* context);
+
+        } // namespace impl_details
+
+        /**
+         * Fixed-size pool of worker threads consuming a shared FIFO queue of tasks.
+         *
+         * Used by the I/O facilities that need to run blocking system calls off the
+         * caller's thread. Tasks still queued when the pool is destroyed are run
+         * before the workers are joined.
+        */
+        class thread_pool {
+        public:
+            /********** Constructors & Destructor **********/
+
+            /** Spawns `threads` workers, defaults to the number of hardware threads (at least 1). */
+            explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency());
+
+            thread_pool(const thread_pool&)  = delete; // copy constructor (deleted)
+            thread_pool(thread_pool&&)       = delete; // move constructor (deleted)
+
+            ~thread_pool(); // drains the queue and joins all workers
+
+        public:
+            /********** Public Member Functions **********/
+
+            void post(std::function<void()> task); // enqueue a task to be run by any worker
+
+            std::size_t size() const noexcept; // number of worker threads
+
+            thread_pool& operator=(const thread_pool&)   = delete; // copy assignment (deleted)
+            thread_pool& operator=(thread_pool&&)        = delete; // move assignment (deleted)
+
+        private:
+            /********** Private Member Functions **********/
+
+            void worker_loop(std::stop_token stop);
+
+        private:
+            /********** Private Members **********/
+
+            std::mutex                          _mutex{};
+            std::condition_variable_any         _cv{};
+            std::deque<std::function<void()>>   _tasks{};
+            std::vector<std::jthread>           _workers{}; // declared last, joined first
+        }; // class thread_pool
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_THREAD_POOL_H
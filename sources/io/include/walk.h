@@ -0,0 +1,110 @@
+#ifndef FABER_WALK_H
+#define FABER_WALK_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint8_t, std::uint64_t
+#include <filesystem>   // std::filesystem::path
+#include <functional>   // std::function
+#include <string_view>  // std::string_view
+
+/********** walk.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /** Type of a directory entry, as reported by the directory listing itself. */
+        enum class entry_type : std::uint8_t {
+            unknown,
+            regular,
+            directory,
+            symlink,
+            block,
+            character,
+            fifo,
+            socket
+        };
+
+        /**
+         * A single entry found while walking a directory tree. The views are only valid
+         * for the duration of the callback (or filter) they were passed to.
+        */
+        struct dir_entry {
+            std::string_view    path;   /** Full path of the entry, `root` joined with every directory down to it. */
+            std::string_view    name;   /** Last component of `path`. */
+            entry_type          type;   /** Symbolic links are reported as such and never followed. */
+            std::uint64_t       inode;  /** Inode number, straight from the directory listing. */
+            std::size_t         depth;  /** 0 for direct children of `root`. */
+        };
+
+        /** Callback invoked for every entry that passes the filter. */
+        using walk_callback = std::function<void(const dir_entry&)>;
+
+        /**
+         * Predicate applied to every entry before anything else happens to it. Entries
+         * it rejects are neither passed to the callback nor, for directories, opened,
+         * so whole subtrees are pruned at no cost.
+        */
+        using walk_filter = std::function<bool(const dir_entry&)>;
+
+        /**
+         * Recursively walks the directory tree under `root` on the calling thread.
+         *
+         * Directories are listed in large batches with `getdents64` and entry types
+         * are taken from `d_type`, so no entry is `stat`ed unless the filesystem does
+         * not report types. Entries are visited in an unspecified order. Directories
+         * that cannot be opened are silently skipped.
+         *
+         * Example usage: `
+         *     using namespace faber;
+         *
+         *     std::size_t headers = 0;
+         *     io::walk("path/to/dir", [&headers](const io::dir_entry& entry) {
+         *         headers += entry.name.ends_with(".h");
+         *     }, [](const io::dir_entry& entry) {
+         *         return entry.name != ".git";
+         *     });
+         * `
+         *
+         * @throws Any exception thrown by `callback` or `filter`.
+         *
+         * @param root Path to a directory. It is not reported itself.
+         * @param callback Invoked for every entry accepted by `filter`.
+         * @param filter Optional, accepts every entry when empty.
+         *
+         * @returns `true` if the walk completed, `false` if `root` could not be opened.
+        */
+        bool
+        walk(const std::filesystem::path& root, const walk_callback& callback, const walk_filter& filter = {});
+
+        /**
+         * Parallel counterpart of `io::walk`. Subdirectories are spread across a pool
+         * of workers, each with its own queue: a worker takes work from the back of
+         * its own queue and, once empty, steals from the front of the others'. The
+         * calling thread takes part in the walk and the call returns once the whole
+         * tree was visited.
+         *
+         * `callback` and `filter` are invoked concurrently from several threads and
+         * must be thread-safe. If either throws, the walk is stopped as soon as
+         * possible and the first exception is rethrown on the calling thread.
+         *
+         * @param root Path to a directory. It is not reported itself.
+         * @param callback Invoked for every entry accepted by `filter`.
+         * @param filter Optional, accepts every entry when empty.
+         * @param threads Number of workers (including the caller), 0 picks the number
+         *        of hardware threads.
+         *
+         * @returns `true` if the walk completed, `false` if `root` could not be opened.
+        */
+        bool
+        parallel_walk(const std::filesystem::path& root, const walk_callback& callback, const walk_filter& filter = {}, std::size_t threads = 0);
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_WALK_H
@@ -0,0 +1,33 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::max
+#include <utility>      // std::move
+
+// internal
+#include <async.h>
+
+namespace io = faber::io;
+
+/********** async.cpp **********/
+
+/********** Constructors & Destructor **********/
+
+io::pool_executor::pool_executor(std::size_t threads) : _pool(std::max<std::size_t>(threads, 1)) { }
+
+/********** Public Member Functions **********/
+
+void io::pool_executor::execute(std::function<void()> task) {
+    _pool.post(std::move(task));
+}
+
+std::size_t io::pool_executor::size() const noexcept {
+    return _pool.size();
+}
+
+/********** API **********/
+
+io::executor& io::default_executor() {
+    static pool_executor instance{};
+    return instance;
+}
@@ -0,0 +1,458 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::min, std::max
+#include <chrono>       // std::chrono::steady_clock
+#include <atomic>       // std::atomic_ref
+#include <cerrno>       // errno
+#include <cstring>      // std::memset
+#include <stdexcept>    // std::runtime_error
+
+// POSIX
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, munmap
+#include <sys/stat.h>   // stat, fstat
+#include <sys/syscall.h>// syscall numbers
+#include <unistd.h>     // pread, pwrite, close, syscall
+
+// Linux
+#include <linux/io_uring.h>
+
+// internal
+#include <batch_io.h>
+
+using batch_io      = faber::io::batch_io;
+using completion    = batch_io::completion;
+
+/********** batch_io.cpp **********/
+
+/********** io_uring **********/
+
+// Raw system call wrappers, the library has no dependency on liburing.
+namespace {
+
+    int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    template<typename T>
+    T load_acquire(T* p) { return std::atomic_ref<T>{*p}.load(std::memory_order_acquire); }
+
+    template<typename T>
+    void store_release(T* p, T v) { std::atomic_ref<T>{*p}.store(v, std::memory_order_release); }
+
+} // namespace
+
+/**
+ * Owns an io_uring instance and the three shared memory regions (submission ring,
+ * completion ring and submission queue entries) it is driven through.
+*/
+struct batch_io::ring {
+
+    /********** RAII **********/
+
+    explicit ring(unsigned entries) {
+        io_uring_params params{};
+        fd = sys_io_uring_setup(entries, &params);
+        if (fd < 0) {
+            return;
+        }
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        single_mmap  = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+
+        sq_ptr = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            sq_ptr = nullptr;
+            return;
+        }
+
+        cq_ptr = single_mmap
+            ? sq_ptr
+            : ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            cq_ptr = nullptr;
+            return;
+        }
+
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes_ptr = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes_ptr == MAP_FAILED) {
+            return;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+        auto* sq = static_cast<char*>(sq_ptr);
+        sq_head  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask  = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<char*>(cq_ptr);
+        cq_head  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask  = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes     = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        sq_entries = params.sq_entries;
+        cq_entries = params.cq_entries;
+    }
+
+    ~ring() {
+        if (sqes)                           { ::munmap(sqes, sqes_size); }
+        if (cq_ptr and cq_ptr != sq_ptr)    { ::munmap(cq_ptr, cq_ring_size); }
+        if (sq_ptr)                         { ::munmap(sq_ptr, sq_ring_size); }
+        if (fd >= 0)                        { ::close(fd); }
+    }
+
+    ring(const ring&)            = delete;
+    ring& operator=(const ring&) = delete;
+
+    /********** Member Functions **********/
+
+    bool ready() const noexcept { return sqes != nullptr; }
+
+    /**
+     * `true` if the kernel implements `IORING_OP_READ` and `IORING_OP_WRITE`. Rings
+     * exist since 5.1 but these opcodes only since 5.6, older kernels fail every
+     * operation with EINVAL. The probe itself came with 5.6, failing means too old.
+    */
+    bool supports_read_write() const noexcept {
+        constexpr unsigned ops = 256;
+        alignas(io_uring_probe) std::byte storage[sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op)]{};
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage);
+        if (sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, ops) < 0) {
+            return false;
+        }
+
+        const auto supported = [probe](unsigned op) {
+            return op <= probe->last_op and op < probe->ops_len and (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        };
+        return supported(IORING_OP_READ) and supported(IORING_OP_WRITE);
+    }
+
+    /** Fills the next free submission queue entry. The caller guarantees there is room. */
+    void push(const operation& op) {
+        const unsigned tail  = *sq_tail; // only written by us
+        const unsigned index = tail & sq_mask;
+
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode    = op.write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd        = op.fd;
+        sqe->addr      = reinterpret_cast<std::uint64_t>(op.buffer);
+        sqe->len       = static_cast<std::uint32_t>(op.length);
+        sqe->off       = op.offset;
+        sqe->user_data = op.id;
+
+        sq_array[index] = index;
+        store_release(sq_tail, tail + 1);
+    }
+
+    /**
+     * Takes back the last `count` entries pushed. Only valid for entries the kernel
+     * has not consumed yet, which without `SQPOLL` is the case until they are passed
+     * to `io_uring_enter`.
+    */
+    void withdraw(unsigned count) {
+        store_release(sq_tail, *sq_tail - count);
+    }
+
+    /********** Members **********/
+
+    int             fd{-1};
+    bool            single_mmap{false};
+    void*           sq_ptr{nullptr};
+    void*           cq_ptr{nullptr};
+    std::size_t     sq_ring_size{0};
+    std::size_t     cq_ring_size{0};
+    std::size_t     sqes_size{0};
+
+    unsigned*       sq_head{nullptr};
+    unsigned*       sq_tail{nullptr};
+    unsigned*       sq_array{nullptr};
+    unsigned        sq_mask{0};
+    unsigned        sq_entries{0};
+    io_uring_sqe*   sqes{nullptr};
+
+    unsigned*       cq_head{nullptr};
+    unsigned*       cq_tail{nullptr};
+    unsigned        cq_mask{0};
+    unsigned        cq_entries{0};
+    io_uring_cqe*   cqes{nullptr};
+};
+
+/********** Constructors & Destructor **********/
+
+batch_io::batch_io(file_monitor& monitor, unsigned queue_depth)
+    : _monitor(monitor), _queue_depth(std::max(queue_depth, 1U)) {
+
+    if (auto r = std::make_unique<ring>(_queue_depth); r->ready() and r->supports_read_write()) {
+        _queue_depth = std::min(_queue_depth, r->sq_entries);
+        _ring = std::move(r);
+    } else {
+        _pool = std::make_unique<thread_pool>();
+    }
+}
+
+batch_io::~batch_io() {
+    // Buffers of operations in flight belong to the caller, the kernel (or a pool
+    // worker) must be done with them before the descriptors go away.
+    std::vector<completion> discarded{};
+    while (_in_flight > 0) {
+        wait(discarded, _in_flight);
+    }
+    _pool.reset();
+
+    for (const auto& [filename, cached] : _descriptors) {
+        ::close(cached.fd);
+    }
+    for (const int fd : _retired) {
+        ::close(fd);
+    }
+}
+
+/********** Private Member Functions **********/
+
+int batch_io::descriptor_for(std::string_view filename, bool write, file_stats*& stats) {
+    const auto it = _monitor.find(filename);
+    if (it == _monitor.data().cend()) {
+        throw std::runtime_error{"error: file not opened on monitor."};
+    }
+    stats = it->second.stats.get();
+
+    const auto mode = it->second.mode;
+    const bool in   = (mode & std::fstream::in) != 0;
+    const bool out  = (mode & (std::fstream::out | std::fstream::app)) != 0;
+    if (write ? not out : not in) {
+        throw std::runtime_error{"error: file not opened on monitor with the required mode."};
+    }
+
+    // The file may have been closed and recreated under the same name since it was
+    // cached, a descriptor is only reused while the path still leads to its inode.
+    const std::string path{filename};
+    struct stat st{};
+    const bool exists = ::stat(path.c_str(), &st) == 0;
+    const auto cached = _descriptors.find(filename);
+    if (cached != _descriptors.end()) {
+        if (exists and cached->second.device == static_cast<std::uint64_t>(st.st_dev) and cached->second.inode == static_cast<std::uint64_t>(st.st_ino)) {
+            return cached->second.fd;
+        }
+        // Queued or in flight operations may still use it, closed once none are left.
+        _retired.push_back(cached->second.fd);
+        _descriptors.erase(cached);
+    }
+
+    const int flags = (in and out) ? O_RDWR : (out ? O_WRONLY : O_RDONLY);
+    const int fd    = ::open(path.c_str(), flags | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error{"error: could not open file"};
+    }
+    if (::fstat(fd, &st) == -1) {
+        ::close(fd);
+        throw std::runtime_error{"error: could not open file"};
+    }
+    _descriptors.emplace(filename, descriptor{ fd, static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino) });
+    return fd;
+}
+
+void batch_io::close_retired() {
+    if (_in_flight > 0 or not _queued.empty()) {
+        return;
+    }
+    for (const int fd : _retired) {
+        ::close(fd);
+    }
+    _retired.clear();
+}
+
+std::uint64_t batch_io::enqueue(std::string_view filename, std::byte* buffer, std::size_t length, std::uint64_t offset, bool write) {
+    // A submission queue entry holds a 32 bit length, larger ones would silently wrap.
+    if (length > max_length) {
+        throw std::runtime_error{"error: operation longer than batch_io::max_length."};
+    }
+
+    file_stats* stats = nullptr;
+    const int fd = descriptor_for(filename, write, stats);
+    const auto id = _next_id++;
+    _queued.push_back(operation{ id, fd, buffer, length, offset, write, stats });
+    return id;
+}
+
+std::size_t batch_io::submit_ring() {
+    std::size_t submitted = 0;
+    try {
+        while (submitted < _queued.size()) {
+
+            // Keep the number of operations owned by the kernel within the queue depth
+            // so the completion ring can never overflow.
+            if (_in_flight - _completed.size() >= _queue_depth) {
+                reap_ring(1);
+            }
+
+            const auto room  = _queue_depth - (_in_flight - _completed.size());
+            const auto count = static_cast<unsigned>(std::min(room, _queued.size() - submitted));
+            const auto now = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < count; ++i) {
+                const auto& op = _queued[submitted + i];
+                _ring->push(op);
+                if (op.stats) {
+                    _tracked.emplace(op.id, tracked{ op.stats, now, op.write });
+                }
+            }
+
+            // One system call for the whole chunk.
+            unsigned pending = count;
+            while (pending > 0) {
+                const int ret = sys_io_uring_enter(_ring->fd, pending, 0, 0);
+                if (ret < 0) {
+                    if (errno == EINTR or errno == EAGAIN or errno == EBUSY) {
+                        reap_ring(0);
+                        continue;
+                    }
+
+                    // The entries the kernel didn't take are withdrawn, they stay queued.
+                    _ring->withdraw(pending);
+                    for (auto i = count - pending; i < count; ++i) {
+                        _tracked.erase(_queued[submitted + i].id);
+                    }
+                    _in_flight += count - pending;
+                    submitted  += count - pending;
+                    throw std::runtime_error{"error: io_uring submission failed"};
+                }
+                pending -= static_cast<unsigned>(ret);
+            }
+
+            _in_flight += count;
+            submitted  += count;
+        }
+    } catch (...) {
+        // Whatever was handed over is in flight, only the rest can be submitted again.
+        _queued.erase(_queued.begin(), _queued.begin() + static_cast<std::ptrdiff_t>(submitted));
+        throw;
+    }
+    _queued.clear();
+    return submitted;
+}
+
+std::size_t batch_io::submit_pool() {
+    std::size_t submitted = 0;
+    try {
+        for (const auto& op : _queued) {
+            _pool->post([this, op] {
+                const auto start = std::chrono::steady_clock::now();
+                const auto n = op.write
+                    ? ::pwrite(op.fd, op.buffer, op.length, static_cast<off_t>(op.offset))
+                    : ::pread(op.fd, op.buffer, op.length, static_cast<off_t>(op.offset));
+                const std::int64_t result = (n < 0) ? -static_cast<std::int64_t>(errno) : n;
+                if (op.stats) {
+                    op.stats->record(op.write ? file_stats::op::write : file_stats::op::read,
+                        static_cast<std::uint64_t>(std::max<std::int64_t>(result, 0)), std::chrono::steady_clock::now() - start);
+                }
+                {
+                    std::lock_guard lock{_mutex};
+                    _pool_completed.push_back(completion{ op.id, result });
+                }
+                _cv.notify_one();
+            });
+            ++_in_flight;
+            ++submitted;
+        }
+    } catch (...) {
+        _queued.erase(_queued.begin(), _queued.begin() + static_cast<std::ptrdiff_t>(submitted));
+        throw;
+    }
+    _queued.clear();
+    return submitted;
+}
+
+void batch_io::reap_ring(unsigned min_completions) {
+    if (min_completions > 0) {
+        while (sys_io_uring_enter(_ring->fd, 0, min_completions, IORING_ENTER_GETEVENTS) < 0) {
+            if (errno != EINTR) {
+                throw std::runtime_error{"error: io_uring wait failed"};
+            }
+        }
+    }
+
+    unsigned head       = *_ring->cq_head; // only written by us
+    const unsigned tail = load_acquire(_ring->cq_tail);
+    const auto now      = std::chrono::steady_clock::now();
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = _ring->cqes[head & _ring->cq_mask];
+        _completed.push_back(completion{ cqe.user_data, cqe.res });
+
+        if (_tracked.empty()) {
+            continue;
+        }
+        if (const auto it = _tracked.find(cqe.user_data); it != _tracked.end()) {
+            const auto& t = it->second;
+            t.stats->record(t.write ? file_stats::op::write : file_stats::op::read,
+                static_cast<std::uint64_t>(std::max(cqe.res, 0)), now - t.submitted);
+            _tracked.erase(it);
+        }
+    }
+    store_release(_ring->cq_head, head);
+}
+
+/********** Public Member Functions **********/
+
+std::uint64_t batch_io::queue_read(std::string_view filename, std::span<std::byte> buffer, std::uint64_t offset) {
+    return enqueue(filename, buffer.data(), buffer.size(), offset, false);
+}
+
+std::uint64_t batch_io::queue_write(std::string_view filename, std::span<const std::byte> buffer, std::uint64_t offset) {
+    // The buffer is only ever read from, the cast only lets both kinds share `operation`.
+    return enqueue(filename, const_cast<std::byte*>(buffer.data()), buffer.size(), offset, true);
+}
+
+std::size_t batch_io::submit() {
+    return _ring ? submit_ring() : submit_pool();
+}
+
+std::size_t batch_io::wait(std::vector<completion>& out, std::size_t min_completions) {
+    if (_ring) {
+        // Completions reaped while submitting count towards the minimum.
+        const auto ready  = _completed.size();
+        const auto needed = std::min(min_completions > ready ? min_completions - ready : 0, _in_flight - ready);
+        reap_ring(static_cast<unsigned>(needed));
+        const auto count = _completed.size();
+        out.insert(out.end(), _completed.begin(), _completed.end());
+        _completed.clear();
+        _in_flight -= count;
+        close_retired();
+        return count;
+    }
+
+    std::unique_lock lock{_mutex};
+    const auto target = std::min(min_completions, _in_flight);
+    _cv.wait(lock, [&] { return _pool_completed.size() >= target; });
+
+    const auto count = _pool_completed.size();
+    out.insert(out.end(), _pool_completed.begin(), _pool_completed.end());
+    _pool_completed.clear();
+    _in_flight -= count;
+    lock.unlock();
+    close_retired();
+    return count;
+}
+
+std::size_t batch_io::in_flight() const noexcept {
+    return _in_flight;
+}
+
+bool batch_io::uses_io_uring() const noexcept {
+    return _ring != nullptr;
+}
@@ -0,0 +1,326 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::min
+#include <atomic>       // std::atomic
+#include <cerrno>       // errno
+#include <cstdint>      // std::uint64_t
+#include <cstdlib>      // std::aligned_alloc, std::free
+#include <cstring>      // std::memcpy, std::memmove
+
+// POSIX
+#include <fcntl.h>      // open, fcntl, O_DIRECT
+#include <stdio.h>      // rename
+#include <sys/stat.h>   // stat, fchmod
+#include <sys/uio.h>    // writev
+#include <unistd.h>     // write, close, fsync, fdatasync, unlink, getpid, sysconf
+
+// internal
+#include <byte_sink.h>
+#include <commit_group.h>
+
+using byte_sink = faber::io::byte_sink;
+
+/********** byte_sink.cpp **********/
+
+namespace {
+
+    std::size_t page_size() noexcept {
+        static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    /** Turns on `O_DIRECT` on an open descriptor, `false` if the filesystem refuses it. */
+    bool enable_direct(int fd) noexcept {
+        const int flags = ::fcntl(fd, F_GETFL);
+        return flags != -1 and ::fcntl(fd, F_SETFL, flags | O_DIRECT) == 0;
+    }
+
+    std::string parent_directory(const std::string& filename) {
+        const auto slash = filename.rfind('/');
+        if (slash == std::string::npos) {
+            return ".";
+        }
+        return slash == 0 ? "/" : filename.substr(0, slash);
+    }
+
+} // namespace
+
+/********** Constructors & Destructor **********/
+
+byte_sink::byte_sink(const std::string& filename, const sink_options& options) {
+    open(filename, options);
+}
+
+byte_sink::~byte_sink() {
+    // Not closed explicitly: the writer may have been interrupted by an exception, a
+    // durable sink must not commit what may be a partial file.
+    discard();
+}
+
+/********** Private Member Functions **********/
+
+bool byte_sink::write_out(const std::byte* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(_fd, data, size);
+        if (n == -1) {
+            if (errno == EINTR) { continue; }
+            return _good = false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool byte_sink::write_out(const std::byte* a, std::size_t a_size, const std::byte* b, std::size_t b_size) {
+    iovec iov[2] = {
+        { const_cast<std::byte*>(a), a_size },
+        { const_cast<std::byte*>(b), b_size }
+    };
+
+    ssize_t n{};
+    do {
+        n = ::writev(_fd, iov, 2);
+    } while (n == -1 and errno == EINTR);
+    if (n == -1) {
+        return _good = false;
+    }
+
+    // Short write, finish piece by piece.
+    const auto written = static_cast<std::size_t>(n);
+    if (written < a_size) {
+        return write_out(a + written, a_size - written) and write_out(b, b_size);
+    }
+    return write_out(b + (written - a_size), b_size - (written - a_size));
+}
+
+bool byte_sink::flush_impl(bool final) {
+    if (not _good or _used == 0) {
+        return _good;
+    }
+
+    if (not _direct) {
+        const auto size = _used;
+        _used = 0;
+        return write_out(_buffer, size);
+    }
+
+    // `O_DIRECT` only accepts whole blocks, keep the partial one for later.
+    const auto aligned = _used & ~(page_size() - 1);
+    if (aligned > 0) {
+        if (not write_out(_buffer, aligned)) {
+            return false;
+        }
+        std::memmove(_buffer, _buffer + aligned, _used - aligned);
+        _used -= aligned;
+    }
+
+    if (final and _used > 0) {
+        // Last partial block, written through the page cache.
+        const int flags = ::fcntl(_fd, F_GETFL);
+        if (flags == -1 or ::fcntl(_fd, F_SETFL, flags & ~O_DIRECT) == -1) {
+            return _good = false;
+        }
+        _direct = false;
+        const auto tail = _used;
+        _used = 0;
+        return write_out(_buffer, tail);
+    }
+    return true;
+}
+
+int byte_sink::open_temporary(const std::string& filename, int flags) {
+    static std::atomic<std::uint64_t> counter{0};
+
+    const auto prefix = filename + ".tmp." + std::to_string(::getpid()) + '.';
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        auto name = prefix + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+        const int fd = ::open(name.c_str(), (flags & ~O_TRUNC) | O_EXCL, 0666);
+        if (fd == -1) {
+            if (errno == EEXIST) { continue; } // leftover of a crashed process
+            return -1;
+        }
+
+        // The replacement keeps the permissions of the file it replaces.
+        if (struct stat st{}; ::stat(filename.c_str(), &st) == 0) {
+            ::fchmod(fd, st.st_mode & 07777);
+        }
+        _target    = filename;
+        _temporary = std::move(name);
+        return fd;
+    }
+    return -1;
+}
+
+bool byte_sink::commit() {
+    if (::rename(_temporary.c_str(), _target.c_str()) == -1) {
+        return false;
+    }
+
+    // The rename itself is only durable once the directory is.
+    const int dir = ::open(parent_directory(_target).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir == -1) {
+        return false;
+    }
+    const bool synced = _group ? _group->sync(dir) : ::fsync(dir) == 0;
+    ::close(dir);
+    return synced;
+}
+
+/********** Public Member Functions **********/
+
+bool byte_sink::open(const std::string& filename, const sink_options& options) {
+    close();
+
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    if (options.durable) {
+        _fd     = open_temporary(filename, flags);
+        _direct = (_fd != -1) and options.direct and enable_direct(_fd);
+        _group  = options.group;
+    } else {
+        _fd = ::open(filename.c_str(), flags | (options.direct ? O_DIRECT : 0), 0666);
+        _direct = (_fd != -1) and options.direct;
+        if (_fd == -1 and options.direct and errno == EINVAL) {
+            // Filesystem without `O_DIRECT` support (tmpfs, for instance).
+            _fd = ::open(filename.c_str(), flags, 0666);
+        }
+    }
+    if (_fd == -1) {
+        return false;
+    }
+
+    const auto page = page_size();
+    _capacity = std::max(page, (options.buffer_size + page - 1) & ~(page - 1));
+    _buffer   = static_cast<std::byte*>(std::aligned_alloc(page, _capacity));
+    if (not _buffer) {
+        discard();
+        return false;
+    }
+
+    _used  = 0;
+    _total = 0;
+    _good  = true;
+    return true;
+}
+
+bool byte_sink::close() {
+    if (_fd == -1) {
+        return false;
+    }
+
+    flush_impl(true);
+    if (not _target.empty() and _good) {
+        // Contents first, the rename must never reach the disk before them.
+        if (not (_group ? _group->sync(_fd) : ::fdatasync(_fd) == 0)) {
+            _good = false;
+        }
+    }
+    if (::close(_fd) == -1) {
+        _good = false;
+    }
+    std::free(_buffer);
+
+    _fd     = -1;
+    _buffer = nullptr;
+    _used   = 0;
+
+    if (not _target.empty()) {
+        if (not (_good and commit())) {
+            ::unlink(_temporary.c_str());
+            _good = false;
+        }
+        _target.clear();
+        _temporary.clear();
+    }
+    return _good;
+}
+
+void byte_sink::discard() {
+    if (_fd == -1) {
+        return;
+    }
+    if (_target.empty()) {
+        close();
+        return;
+    }
+
+    ::close(_fd);
+    ::unlink(_temporary.c_str());
+    std::free(_buffer);
+
+    _fd     = -1;
+    _buffer = nullptr;
+    _used   = 0;
+    _good   = false;
+    _target.clear();
+    _temporary.clear();
+}
+
+void byte_sink::write(std::span<const std::byte> bytes) {
+    if (not _good) {
+        return;
+    }
+    _total += bytes.size();
+
+    const auto* data = bytes.data();
+    auto size = bytes.size();
+
+    if (size < _capacity - _used) {
+        std::memcpy(_buffer + _used, data, size);
+        _used += size;
+        return;
+    }
+
+    if (not _direct) {
+        // Buffered bytes and the new ones in a single system call, no copy.
+        write_out(_buffer, _used, data, size);
+        _used = 0;
+        return;
+    }
+
+    // `O_DIRECT` needs aligned memory, stage everything through the buffer.
+    while (size > 0 and _good) {
+        const auto chunk = std::min(size, _capacity - _used);
+        std::memcpy(_buffer + _used, data, chunk);
+        _used += chunk;
+        data  += chunk;
+        size  -= chunk;
+        if (_used == _capacity) {
+            flush_impl(false);
+        }
+    }
+}
+
+void byte_sink::write(std::string_view text) {
+    write(std::as_bytes(std::span{text.data(), text.size()}));
+}
+
+void byte_sink::put(char c) {
+    if (_good and _used + 1 < _capacity) {
+        _buffer[_used++] = static_cast<std::byte>(c);
+        ++_total;
+        return;
+    }
+    write(std::string_view{&c, 1});
+}
+
+bool byte_sink::flush() {
+    return flush_impl(false);
+}
+
+bool byte_sink::is_open() const noexcept {
+    return _fd != -1;
+}
+
+bool byte_sink::good() const noexcept {
+    return _good;
+}
+
+bool byte_sink::direct() const noexcept {
+    return _direct;
+}
+
+std::size_t byte_sink::bytes_written() const noexcept {
+    return _total;
+}
@@ -0,0 +1,95 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <utility>      // std::exchange, std::pair
+#include <vector>       // std::vector
+
+// POSIX
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // syncfs, fdatasync
+
+// internal
+#include <commit_group.h>
+
+using commit_group = faber::io::commit_group;
+
+/********** commit_group.cpp **********/
+
+/********** Constructors & Destructor **********/
+
+commit_group::commit_group(strategy how) noexcept : _strategy(how) { }
+
+/********** Private Member Functions **********/
+
+void commit_group::flush(std::vector<request*>& batch) const {
+    // Requests are grouped by filesystem (syncfs) or by file (fdatasync), each group
+    // being flushed once on behalf of all its members.
+    std::vector<std::pair<struct stat, bool>> flushed{};
+    for (auto* req : batch) {
+        struct stat st{};
+        if (::fstat(req->fd, &st) == -1) {
+            req->ok = false;
+            continue;
+        }
+
+        const auto same = [&](const struct stat& other) {
+            return other.st_dev == st.st_dev and (_strategy == strategy::syncfs or other.st_ino == st.st_ino);
+        };
+
+        bool found = false;
+        for (const auto& [other, ok] : flushed) {
+            if (same(other)) {
+                req->ok = ok;
+                found   = true;
+                break;
+            }
+        }
+        if (not found) {
+            req->ok = (_strategy == strategy::syncfs ? ::syncfs(req->fd) : ::fdatasync(req->fd)) == 0;
+            flushed.emplace_back(st, req->ok);
+        }
+    }
+}
+
+/********** Public Member Functions **********/
+
+bool commit_group::sync(int fd) {
+    request self{fd};
+
+    std::unique_lock lock{_mutex};
+    _pending.push_back(&self);
+    ++_requests;
+
+    // Either a leader picks this request up, or the current flush ends and this
+    // thread leads the next one.
+    _cv.wait(lock, [&] { return self.done or not _flushing; });
+    if (self.done) {
+        return self.ok;
+    }
+
+    _flushing = true;
+    auto batch = std::exchange(_pending, {});
+    lock.unlock();
+
+    flush(batch);
+
+    lock.lock();
+    for (auto* req : batch) {
+        req->done = true;
+    }
+    _flushing = false;
+    ++_flushes;
+    lock.unlock();
+    _cv.notify_all();
+    return self.ok;
+}
+
+std::uint64_t commit_group::flushes() const {
+    std::lock_guard lock{_mutex};
+    return _flushes;
+}
+
+std::uint64_t commit_group::requests() const {
+    std::lock_guard lock{_mutex};
+    return _requests;
+}
@@ -0,0 +1,146 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::max
+#include <bit>          // std::bit_ceil, std::bit_width
+#include <limits>       // std::numeric_limits
+#include <mutex>        // std::unique_lock
+#include <stdexcept>    // std::runtime_error, std::out_of_range
+#include <thread>       // std::thread::hardware_concurrency
+#include <tuple>        // std::forward_as_tuple
+
+// internal
+#include <concurrent_file_monitor.h>
+#include <io.h>
+
+using concurrent_file_monitor   = faber::io::concurrent_file_monitor;
+using file_info_t               = concurrent_file_monitor::file_info_t;
+
+/********** concurrent_file_monitor.cpp **********/
+
+/********** Constructors & Destructor **********/
+
+concurrent_file_monitor::concurrent_file_monitor(std::size_t shard_count) {
+    if (shard_count == 0) {
+        // A few shards per hardware thread keeps the odds of two threads hitting the
+        // same lock low without wasting memory on mostly empty tables.
+        shard_count = std::max<std::size_t>(std::thread::hardware_concurrency() * 4, 16);
+    }
+    shard_count = std::bit_ceil(shard_count);
+
+    _shard_mask  = shard_count - 1;
+    _shard_shift = std::min<unsigned>(std::numeric_limits<std::size_t>::digits - std::bit_width(_shard_mask),
+                                      std::numeric_limits<std::size_t>::digits - 1);
+    _shards      = std::make_unique<shard[]>(shard_count);
+}
+
+concurrent_file_monitor::concurrent_file_monitor(std::initializer_list<const char*> ilist) : concurrent_file_monitor() {
+    for (const auto& entry : ilist) {
+        open(entry);
+    }
+}
+
+concurrent_file_monitor::concurrent_file_monitor(std::initializer_list<ilist_entry> ilist) : concurrent_file_monitor() {
+    for (const auto& [filename, mode] : ilist) {
+        open(filename, mode);
+    }
+}
+
+/********** Private Member Functions **********/
+
+concurrent_file_monitor::shard& concurrent_file_monitor::shard_for(std::size_t hash) const noexcept {
+    // The tables hash with the same function and pick buckets from the low bits,
+    // take the shard from the high bits so a shard's keys still spread over them.
+    return _shards[(hash >> _shard_shift) & _shard_mask];
+}
+
+std::fstream& concurrent_file_monitor::open_impl(const char* filename, std::fstream::openmode mode) {
+    const std::string_view key{filename};
+    auto& s = shard_for(string_hash{}(key));
+
+    {
+        std::shared_lock lock{s.mutex};
+        if (s.files.find(key) != s.files.end()) {
+            throw std::runtime_error{"error: file already opened on monitor."};
+        }
+    }
+
+    // Opening the file is by far the slowest part, do it without holding any lock.
+    auto f_ptr = faber::io::make_pooled_fstream(_buffers);
+    f_ptr->open(filename, mode);
+    if (not *f_ptr) {
+        throw std::runtime_error{"error: could not open file"};
+    }
+    const auto size = faber::io::filesize(*f_ptr);
+
+    std::unique_lock lock{s.mutex};
+    const auto& [iterator, inserted] = s.files.emplace(
+        std::piecewise_construct,
+        std::forward_as_tuple(key),
+        std::forward_as_tuple(std::move(f_ptr), mode, size)
+    );
+    if (not inserted) {
+        // Another thread registered the same file in the meantime.
+        throw std::runtime_error{"error: file already opened on monitor."};
+    }
+    return *iterator->second.stream;
+}
+
+/********** Public Member Functions **********/
+
+std::fstream& concurrent_file_monitor::open(const char* filename) {
+    return open_impl(filename, (std::fstream::in | std::fstream::out));
+}
+
+std::fstream& concurrent_file_monitor::open(const char* filename, std::fstream::openmode mode) {
+    return open_impl(filename, mode);
+}
+
+void concurrent_file_monitor::close(std::string_view filename) {
+    auto& s = shard_for(string_hash{}(filename));
+
+    // Extract the node so the stream is flushed and closed outside the lock.
+    hashtable::node_type node{};
+    {
+        std::unique_lock lock{s.mutex};
+        if (const auto it = s.files.find(filename); it != s.files.end()) {
+            node = s.files.extract(it);
+        }
+    }
+}
+
+file_info_t* concurrent_file_monitor::find(std::string_view filename) const {
+    auto& s = shard_for(string_hash{}(filename));
+    std::shared_lock lock{s.mutex};
+    const auto it = s.files.find(filename);
+    return (it != s.files.end()) ? &it->second : nullptr;
+}
+
+bool concurrent_file_monitor::contains(std::string_view filename) const {
+    return find(filename) != nullptr;
+}
+
+file_info_t& concurrent_file_monitor::operator[](std::string_view key) const {
+    if (auto* info = find(key)) {
+        return *info;
+    }
+    throw std::out_of_range{"error: file not opened on monitor."};
+}
+
+std::size_t concurrent_file_monitor::size() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i <= _shard_mask; ++i) {
+        std::shared_lock lock{_shards[i].mutex};
+        total += _shards[i].files.size();
+    }
+    return total;
+}
+
+void concurrent_file_monitor::for_each(const std::function<void(std::string_view, file_info_t&)>& fn) const {
+    for (std::size_t i = 0; i <= _shard_mask; ++i) {
+        std::shared_lock lock{_shards[i].mutex};
+        for (auto& [filename, info] : _shards[i].files) {
+            fn(filename, info);
+        }
+    }
+}
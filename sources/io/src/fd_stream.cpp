@@ -0,0 +1,549 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::min
+#include <chrono>       // std::chrono::steady_clock
+#include <cstring>      // std::memcpy
+#include <memory>       // std::allocator_traits
+#include <new>          // placement new
+#include <utility>      // std::exchange
+
+// C stdlib
+#include <cerrno>       // errno, EINTR
+
+// POSIX
+#include <fcntl.h>      // open
+#include <unistd.h>     // read, write, lseek, close
+
+// internal
+#include <fd_stream.h>
+
+namespace io = faber::io;
+
+/********** fd_stream.cpp **********/
+
+/********** Internal Helpers **********/
+
+namespace {
+
+    /** `open` flags equivalent to an `openmode`, as listed for `std::filebuf::open`. -1 if the combination is invalid. */
+    int to_flags(std::ios_base::openmode mode) noexcept {
+        // `openmode` is an enumeration, combinations of its flags aren't enumerators
+        // and can't be switched on without warnings: switch on the plain bits.
+        constexpr auto in    = static_cast<unsigned>(std::ios_base::in);
+        constexpr auto out   = static_cast<unsigned>(std::ios_base::out);
+        constexpr auto trunc = static_cast<unsigned>(std::ios_base::trunc);
+        constexpr auto app   = static_cast<unsigned>(std::ios_base::app);
+
+        switch (static_cast<unsigned>(mode & ~(std::ios_base::binary | std::ios_base::ate))) {
+            case in:                    return O_RDONLY;
+            case out:
+            case out | trunc:           return O_WRONLY | O_CREAT | O_TRUNC;
+            case app:
+            case out | app:             return O_WRONLY | O_CREAT | O_APPEND;
+            case in | out:              return O_RDWR;
+            case in | out | trunc:      return O_RDWR | O_CREAT | O_TRUNC;
+            case in | app:
+            case in | out | app:        return O_RDWR | O_CREAT | O_APPEND;
+            default:                    return -1;
+        }
+    }
+
+    /** `read` retried on EINTR. */
+    ssize_t read_some(int fd, char* data, std::size_t size) noexcept {
+        ssize_t n = 0;
+        do {
+            n = ::read(fd, data, size);
+        } while (n == -1 and errno == EINTR);
+        return n;
+    }
+
+    /** Writes the whole range, retrying on short writes and EINTR. */
+    bool write_all(int fd, const char* data, std::size_t size) noexcept {
+        while (size > 0) {
+            const ssize_t n = ::write(fd, data, size);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * `std::streambuf` only lets a buffer look at its own get and put areas. Pointers
+     * to its protected members, formed through a derived class, apply to any buffer.
+    */
+    struct buffer_areas : std::streambuf {
+        /** Bytes read from the file, not consumed yet. */
+        static std::streamsize readable(const std::streambuf& b) noexcept {
+            return (b.*&buffer_areas::egptr)() - (b.*&buffer_areas::gptr)();
+        }
+
+        /** Bytes written into the buffer, not flushed to the file yet. */
+        static std::streamsize pending(const std::streambuf& b) noexcept {
+            return (b.*&buffer_areas::pptr)() - (b.*&buffer_areas::pbase)();
+        }
+
+        /** Room left in the put area. */
+        static std::streamsize writable(const std::streambuf& b) noexcept {
+            return (b.*&buffer_areas::epptr)() - (b.*&buffer_areas::pptr)();
+        }
+    };
+
+    using stats_clock = std::chrono::steady_clock;
+
+    /** Records a transfer of `bytes` that started at `start`, empty writes never reached the file. */
+    void record(io::file_stats* stats, io::file_stats::op kind, std::streamsize bytes, stats_clock::time_point start) noexcept {
+        if (kind == io::file_stats::op::write and bytes <= 0) {
+            return;
+        }
+        stats->record(kind, static_cast<std::uint64_t>(std::max<std::streamsize>(bytes, 0)),
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(stats_clock::now() - start));
+    }
+
+} // namespace
+
+/********** buffer_pool **********/
+
+io::buffer_pool::buffer_pool(std::size_t buffer_size, std::pmr::memory_resource* upstream)
+    : _buffer_size(buffer_size > 0 ? buffer_size : default_buffer_size), _upstream(upstream) { }
+
+io::buffer_pool::~buffer_pool() {
+    for (node* n = _all; n;) {
+        node* next = n->next_all;
+        _upstream->deallocate(n, sizeof(node) + _buffer_size, alignof(std::max_align_t));
+        n = next;
+    }
+}
+
+char* io::buffer_pool::acquire() {
+    std::lock_guard lock{_mutex};
+    node* n = _free;
+    if (n) {
+        _free = n->next_free;
+    } else {
+        void* memory = _upstream->allocate(sizeof(node) + _buffer_size, alignof(std::max_align_t));
+        n = ::new (memory) node{_all, nullptr};
+        _all = n;
+        ++_allocated;
+    }
+    return reinterpret_cast<char*>(n + 1);
+}
+
+void io::buffer_pool::release(char* buffer) {
+    if (not buffer) {
+        return;
+    }
+    node* n = reinterpret_cast<node*>(buffer) - 1;
+
+    std::lock_guard lock{_mutex};
+    n->next_free = _free;
+    _free = n;
+}
+
+std::size_t io::buffer_pool::buffer_size() const noexcept {
+    return _buffer_size;
+}
+
+std::size_t io::buffer_pool::allocated() const {
+    std::lock_guard lock{_mutex};
+    return _allocated;
+}
+
+io::buffer_pool& io::default_buffer_pool() {
+    static buffer_pool instance{};
+    return instance;
+}
+
+/********** fd_streambuf **********/
+
+io::fd_streambuf::fd_streambuf(buffer_pool& pool) noexcept : _pool(pool) { }
+
+io::fd_streambuf::~fd_streambuf() {
+    close();
+}
+
+io::fd_streambuf* io::fd_streambuf::open(const std::string& filename, std::ios_base::openmode mode) {
+    close();
+
+    const int flags = to_flags(mode);
+    if (flags == -1) {
+        return nullptr;
+    }
+
+    const int fd = ::open(filename.c_str(), flags | O_CLOEXEC, 0666);
+    if (fd == -1) {
+        return nullptr;
+    }
+    if ((mode & std::ios_base::ate) and ::lseek(fd, 0, SEEK_END) == -1) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    _fd   = fd;
+    _mode = mode;
+    return this;
+}
+
+io::fd_streambuf* io::fd_streambuf::attach(int fd, std::ios_base::openmode mode) {
+    close();
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    _fd   = fd;
+    _mode = mode;
+    return this;
+}
+
+io::fd_streambuf* io::fd_streambuf::close() {
+    if (_fd == -1) {
+        return nullptr;
+    }
+
+    const bool flushed = flush_put();
+    setg(nullptr, nullptr, nullptr);
+    const bool closed = ::close(std::exchange(_fd, -1)) == 0;
+    _pool.release(std::exchange(_buffer, nullptr));
+    return (flushed and closed) ? this : nullptr;
+}
+
+bool io::fd_streambuf::is_open() const noexcept {
+    return _fd != -1;
+}
+
+int io::fd_streambuf::native_handle() const noexcept {
+    return _fd;
+}
+
+/********** std::streambuf Overrides **********/
+
+io::fd_streambuf::int_type io::fd_streambuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (_fd == -1 or not (_mode & std::ios_base::in) or not flush_put() or not ensure_buffer()) {
+        return traits_type::eof();
+    }
+
+    const ssize_t n = read_some(_fd, _buffer, _pool.buffer_size());
+    if (n <= 0) {
+        setg(nullptr, nullptr, nullptr);
+        return traits_type::eof();
+    }
+    setg(_buffer, _buffer, _buffer + n);
+    return traits_type::to_int_type(*gptr());
+}
+
+io::fd_streambuf::int_type io::fd_streambuf::overflow(int_type ch) {
+    if (_fd == -1 or not (_mode & (std::ios_base::out | std::ios_base::app)) or not drop_get()) {
+        return traits_type::eof();
+    }
+    if (pptr() == epptr()) { // full, or no put area yet
+        if (not flush_put() or not ensure_buffer()) {
+            return traits_type::eof();
+        }
+        setp(_buffer, _buffer + _pool.buffer_size());
+    }
+
+    if (not traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int io::fd_streambuf::sync() {
+    return flush_put() ? 0 : -1;
+}
+
+std::streamsize io::fd_streambuf::xsgetn(char_type* s, std::streamsize count) {
+    // Drain the get area, then read large remainders straight into `s`.
+    std::streamsize done = std::min<std::streamsize>(count, egptr() - gptr());
+    if (done > 0) {
+        std::memcpy(s, gptr(), static_cast<std::size_t>(done));
+        gbump(static_cast<int>(done));
+    }
+    if (count - done < static_cast<std::streamsize>(_pool.buffer_size())) {
+        return done + std::streambuf::xsgetn(s + done, count - done);
+    }
+    if (_fd == -1 or not (_mode & std::ios_base::in) or not flush_put()) {
+        return done;
+    }
+
+    setg(nullptr, nullptr, nullptr);
+    while (done < count) {
+        const ssize_t n = read_some(_fd, s + done, static_cast<std::size_t>(count - done));
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+std::streamsize io::fd_streambuf::xsputn(const char_type* s, std::streamsize count) {
+    // Small writes are buffered, large ones are written straight from `s`.
+    if (count < static_cast<std::streamsize>(_pool.buffer_size())) {
+        return std::streambuf::xsputn(s, count);
+    }
+    if (_fd == -1 or not (_mode & (std::ios_base::out | std::ios_base::app)) or not drop_get() or not flush_put()) {
+        return 0;
+    }
+    return write_all(_fd, s, static_cast<std::size_t>(count)) ? count : 0;
+}
+
+io::fd_streambuf::pos_type io::fd_streambuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) {
+    const pos_type failed{off_type(-1)};
+    if (_fd == -1) {
+        return failed;
+    }
+
+    // Telling the position (`tellg`, `tellp`) doesn't disturb the buffers.
+    if (dir == std::ios_base::cur and off == 0) {
+        const off_t pos = ::lseek(_fd, 0, SEEK_CUR);
+        if (pos == -1) {
+            return failed;
+        }
+        return pos_type(off_type(pos) - (egptr() - gptr()) + (pptr() - pbase()));
+    }
+
+    if (not flush_put()) {
+        return failed;
+    }
+    if (dir == std::ios_base::cur) {
+        off -= egptr() - gptr(); // relative to the logical position, not the descriptor's
+    }
+    setg(nullptr, nullptr, nullptr);
+
+    const int whence = (dir == std::ios_base::beg) ? SEEK_SET : (dir == std::ios_base::cur) ? SEEK_CUR : SEEK_END;
+    const off_t pos = ::lseek(_fd, static_cast<off_t>(off), whence);
+    return (pos == -1) ? failed : pos_type(off_type(pos));
+}
+
+io::fd_streambuf::pos_type io::fd_streambuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+/********** Private Member Functions **********/
+
+bool io::fd_streambuf::ensure_buffer() {
+    if (not _buffer) {
+        _buffer = _pool.acquire();
+    }
+    return true;
+}
+
+bool io::fd_streambuf::flush_put() {
+    const auto pending = pptr() - pbase();
+    const char* data = pbase();
+    setp(nullptr, nullptr);
+    return pending == 0 or write_all(_fd, data, static_cast<std::size_t>(pending));
+}
+
+bool io::fd_streambuf::drop_get() {
+    const auto unread = egptr() - gptr();
+    setg(nullptr, nullptr, nullptr);
+    return unread == 0 or ::lseek(_fd, -static_cast<off_t>(unread), SEEK_CUR) != -1;
+}
+
+/********** fd_stream **********/
+
+io::fd_stream::fd_stream(buffer_pool& pool) : std::iostream(nullptr), _buf(pool) {
+    this->init(&_buf);
+}
+
+io::fd_stream::fd_stream(const std::string& filename, std::ios_base::openmode mode, buffer_pool& pool) : fd_stream(pool) {
+    open(filename, mode);
+}
+
+void io::fd_stream::open(const std::string& filename, std::ios_base::openmode mode) {
+    if (_buf.open(filename, mode)) {
+        clear();
+    } else {
+        setstate(std::ios_base::failbit);
+    }
+}
+
+void io::fd_stream::close() {
+    if (not _buf.close()) {
+        setstate(std::ios_base::failbit);
+    }
+}
+
+bool io::fd_stream::is_open() const noexcept {
+    return _buf.is_open();
+}
+
+int io::fd_stream::native_handle() const noexcept {
+    return _buf.native_handle();
+}
+
+io::fd_streambuf* io::fd_stream::rdbuf() const noexcept {
+    return &_buf;
+}
+
+/********** pooled_fstream **********/
+
+io::pooled_fstream::pooled_fstream(buffer_pool& pool) : _pool(pool) {
+    borrow();
+}
+
+io::pooled_fstream::~pooled_fstream() {
+    rdbuf()->close(); // flushes into the buffer while it is still ours
+    _pool.release(_buffer);
+}
+
+void io::pooled_fstream::borrow() {
+    if (not _buffer) {
+        _buffer = _pool.acquire();
+        rdbuf()->pubsetbuf(_buffer, static_cast<std::streamsize>(_pool.buffer_size()));
+    }
+}
+
+void io::pooled_fstream::give_back() {
+    if (_buffer) {
+        rdbuf()->pubsetbuf(&_unbuffered, 1);
+        _pool.release(std::exchange(_buffer, nullptr));
+    }
+}
+
+void io::pooled_fstream::record_into(file_stats* stats) {
+    _recorder.stats = stats;
+
+    // `std::ios::rdbuf` picks the buffer I/O goes through, `rdbuf` keeps naming the
+    // file buffer for `open` and `close`. Switching clears the state, kept as it was.
+    const auto state = rdstate();
+    std::ios::rdbuf(stats ? static_cast<std::streambuf*>(&_recorder) : rdbuf());
+    clear(state);
+}
+
+void io::pooled_fstream_deleter::operator()(pooled_fstream* stream) const noexcept {
+    std::pmr::polymorphic_allocator<pooled_fstream> allocator{resource};
+    std::allocator_traits<decltype(allocator)>::destroy(allocator, stream);
+    allocator.deallocate(stream, 1);
+}
+
+io::pooled_fstream_ptr io::make_pooled_fstream(buffer_pool& pool, std::pmr::memory_resource* resource) {
+    std::pmr::polymorphic_allocator<pooled_fstream> allocator{resource};
+    auto* memory = allocator.allocate(1);
+    try {
+        ::new (static_cast<void*>(memory)) pooled_fstream(pool);
+    } catch (...) {
+        allocator.deallocate(memory, 1);
+        throw;
+    }
+    return pooled_fstream_ptr{memory, pooled_fstream_deleter{resource}};
+}
+
+/********** pooled_fstream::recording_buf **********/
+
+io::pooled_fstream::recording_buf::int_type io::pooled_fstream::recording_buf::underflow() {
+    if (not stats or buffer_areas::readable(_file) > 0) {
+        return _file.sgetc();
+    }
+    const auto start = stats_clock::now();
+    const auto ch = _file.sgetc();
+    record(stats, io::file_stats::op::read, buffer_areas::readable(_file), start);
+    return ch;
+}
+
+io::pooled_fstream::recording_buf::int_type io::pooled_fstream::recording_buf::uflow() {
+    if (not stats or buffer_areas::readable(_file) > 0) {
+        return _file.sbumpc();
+    }
+    const auto start = stats_clock::now();
+    const auto ch = _file.sbumpc();
+    const auto consumed = traits_type::eq_int_type(ch, traits_type::eof()) ? 0 : 1;
+    record(stats, io::file_stats::op::read, buffer_areas::readable(_file) + consumed, start);
+    return ch;
+}
+
+io::pooled_fstream::recording_buf::int_type io::pooled_fstream::recording_buf::pbackfail(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return _file.sungetc();
+    }
+    return _file.sputbackc(traits_type::to_char_type(ch));
+}
+
+std::streamsize io::pooled_fstream::recording_buf::showmanyc() {
+    return _file.in_avail();
+}
+
+std::streamsize io::pooled_fstream::recording_buf::xsgetn(char_type* s, std::streamsize count) {
+    const auto buffered = buffer_areas::readable(_file);
+    if (not stats or count <= buffered) {
+        return _file.sgetn(s, count);
+    }
+    const auto start = stats_clock::now();
+    const auto got = _file.sgetn(s, count);
+    record(stats, io::file_stats::op::read, got - buffered + buffer_areas::readable(_file), start);
+    return got;
+}
+
+io::pooled_fstream::recording_buf::int_type io::pooled_fstream::recording_buf::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return (sync() == 0) ? traits_type::not_eof(ch) : traits_type::eof();
+    }
+    if (not stats or buffer_areas::writable(_file) > 0) {
+        return _file.sputc(traits_type::to_char_type(ch));
+    }
+    const auto before = buffer_areas::pending(_file);
+    const auto start = stats_clock::now();
+    const auto put = _file.sputc(traits_type::to_char_type(ch));
+    const auto added = traits_type::eq_int_type(put, traits_type::eof()) ? 0 : 1;
+    record(stats, io::file_stats::op::write, before + added - buffer_areas::pending(_file), start);
+    return put;
+}
+
+std::streamsize io::pooled_fstream::recording_buf::xsputn(const char_type* s, std::streamsize count) {
+    if (not stats) {
+        return _file.sputn(s, count);
+    }
+    // Whether the buffer is flushed or bypassed is up to the file buffer, what left the
+    // put area is what reached the file.
+    const auto before = buffer_areas::pending(_file);
+    const auto start = stats_clock::now();
+    const auto put = _file.sputn(s, count);
+    record(stats, io::file_stats::op::write, before + put - buffer_areas::pending(_file), start);
+    return put;
+}
+
+int io::pooled_fstream::recording_buf::sync() {
+    const auto before = buffer_areas::pending(_file);
+    if (not stats or before == 0) {
+        return _file.pubsync();
+    }
+    const auto start = stats_clock::now();
+    const int result = _file.pubsync();
+    record(stats, io::file_stats::op::write, before - buffer_areas::pending(_file), start);
+    return result;
+}
+
+io::pooled_fstream::recording_buf::pos_type io::pooled_fstream::recording_buf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+    const auto before = buffer_areas::pending(_file);
+    if (not stats or before == 0) {
+        return _file.pubseekoff(off, dir, which);
+    }
+    // Seeking flushes pending writes first.
+    const auto start = stats_clock::now();
+    const auto pos = _file.pubseekoff(off, dir, which);
+    record(stats, io::file_stats::op::write, before - buffer_areas::pending(_file), start);
+    return pos;
+}
+
+io::pooled_fstream::recording_buf::pos_type io::pooled_fstream::recording_buf::seekpos(pos_type pos, std::ios_base::openmode which) {
+    const auto before = buffer_areas::pending(_file);
+    if (not stats or before == 0) {
+        return _file.pubseekpos(pos, which);
+    }
+    const auto start = stats_clock::now();
+    const auto result = _file.pubseekpos(pos, which);
+    record(stats, io::file_stats::op::write, before - buffer_areas::pending(_file), start);
+    return result;
+}
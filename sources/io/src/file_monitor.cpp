@@ -2,23 +2,83 @@
 
 // C++ stdlib
 #include <iostream>     // std::cerr
-#include <stdexcept>    // std::runtime_error
+#include <stdexcept>    // std::runtime_error, std::out_of_range
+#include <string>       // std::string
+#include <utility>      // std::exchange
 
 // C stdlib
+#include <cerrno>  // errno, EMFILE, ENFILE
 #include <cstring> // std::memcpy
 
+// POSIX
+#include <fcntl.h>  // open, posix_fadvise
+#include <unistd.h> // close
+
 // internal
 #include <file_monitor.h>
+#include <file_watcher.h>
 #include <io.h>
+#include "filebuf_handle.h"
 
-using file_monitor  = faber::io::file_monitor;
-using hashtable_t   = file_monitor::hashtable_t;
-using file_info_t   = file_monitor::file_info_t;
+using file_monitor      = faber::io::file_monitor;
+using hashtable_t       = file_monitor::hashtable_t;
+using file_info_t       = file_monitor::file_info_t;
 
 /********** file_monitor.cpp **********/
 
+/********** Internal Helpers **********/
+
+namespace {
+
+    int to_fadvise(faber::io::access_hint hint) noexcept {
+        using faber::io::access_hint;
+        switch (hint) {
+            case access_hint::sequential: return POSIX_FADV_SEQUENTIAL;
+            case access_hint::random:     return POSIX_FADV_RANDOM;
+            case access_hint::willneed:   return POSIX_FADV_WILLNEED;
+            case access_hint::dontneed:   return POSIX_FADV_DONTNEED;
+            default:                      return POSIX_FADV_NORMAL;
+        }
+    }
+
+    /**
+     * Applies `hint` to the stream's own descriptor, readahead settings being per open
+     * file. Without access to it, the hint is approximated through a descriptor of our
+     * own: the page cache is shared, so `willneed` and `dontneed` still take effect and
+     * `sequential` at least gets the file read in ahead. Only `random` (and resetting
+     * to `normal`) can't be applied that way.
+     *
+     * @returns `true` if the hint was applied, approximated or not.
+    */
+    bool advise_stream(std::fstream& stream, std::string_view filename, faber::io::access_hint hint) {
+        using faber::io::access_hint;
+        if (const int fd = faber::io::impl_details::native_handle(stream); fd != -1) {
+            return ::posix_fadvise(fd, 0, 0, to_fadvise(hint)) == 0;
+        }
+
+        int advice{};
+        switch (hint) {
+            case access_hint::sequential:
+            case access_hint::willneed:   advice = POSIX_FADV_WILLNEED; break;
+            case access_hint::dontneed:   advice = POSIX_FADV_DONTNEED; break;
+            default:                      return false;
+        }
+        const int fd = ::open(std::string{filename}.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return false;
+        }
+        const bool advised = ::posix_fadvise(fd, 0, 0, advice) == 0;
+        ::close(fd);
+        return advised;
+    }
+
+} // namespace
+
 /********** Constructors & Destructor **********/
 
+file_monitor::file_monitor(std::pmr::memory_resource* resource)
+    : _resource(resource), _buffers(faber::io::buffer_pool::default_buffer_size, resource), _opened_files(resource) { }
+
 file_monitor::file_monitor(std::initializer_list<const char*> ilist) {
     for (const auto& entry : ilist) {
         open(entry);
@@ -33,29 +93,180 @@ file_monitor::file_monitor(std::initializer_list<ilist_entry> ilist) {
 
 /********** Private Member Functions **********/
 
-std::fstream& file_monitor::open_impl(const char* filename, std::fstream::openmode mode) {
+std::fstream& file_monitor::open_impl(const char* filename, std::fstream::openmode mode, access_hint hint) {
 
-    if (const auto it = find(filename); it != _opened_files.cend()) {
-        throw std::runtime_error{"error: file already opened on monitor."};
-    }
-    
-    auto f_ptr = std::make_unique<std::fstream>(filename, mode);
-    if (not *f_ptr) {
-        throw std::runtime_error{"error: could not open file"};
+    if (const auto it = _opened_files.find(filename); it != _opened_files.end()) {
+        // In caching mode an open on a registered file is a cache hit.
+        auto& [key, info] = *it;
+        if (not info.stream) {
+            // Registered with `open_mapped` only, the stream joins the existing entry.
+            reserve_slot();
+            auto f_ptr = faber::io::make_pooled_fstream(_buffers, _resource);
+            open_stream(*f_ptr, filename, mode);
+            info.size   = faber::io::filesize(*f_ptr);
+            info.mode   = mode;
+            info.stream = std::move(f_ptr);
+            lru_push_front(info);
+            info.resident = true;
+            ++_open_streams;
+            if (hint != access_hint::normal) {
+                info.hint = hint;
+            }
+            if (info.hint != access_hint::normal) {
+                advise_stream(*info.stream, key, info.hint);
+            }
+            if (info.stats) {
+                info.stats->touch();
+                info.stream->record_into(info.stats.get());
+            }
+            return *info.stream;
+        }
+        if (_capacity == 0) {
+            throw std::runtime_error{"error: file already opened on monitor."};
+        }
+        if (info.mode != mode) {
+            throw std::runtime_error{"error: file already opened on monitor with a different mode."};
+        }
+        if (info.stats) {
+            info.stats->touch();
+        }
+        auto& stream = acquire(key, info);
+        if (hint != access_hint::normal and hint != info.hint) {
+            info.hint = hint;
+            advise_stream(stream, key, hint);
+        }
+        return stream;
     }
 
-    // Transfer ownership of pointer to a file_info_t temporary which will be constructed
-    // in place as a new value in the hash table with `filename` as its key.
-    // `std::unordered_map::emplace` returns a pair containing an iterator to the possibly
+    reserve_slot();
+    auto f_ptr = faber::io::make_pooled_fstream(_buffers, _resource);
+    open_stream(*f_ptr, filename, mode);
+
+    // Transfer ownership of pointer to a file_info_t which will be constructed in place
+    // as a new value in the hash table with `filename` as its key.
+    // `flat_table::try_emplace` returns a pair containing an iterator to the possibly
     // newly inserted kv-pair and a boolean. This boolean will be set to true if the value
     // was actually inserted, and false if the key was already present.
     // Values `inserted` and `key` below are unused but required for destructuring.
-    [[maybe_unused]] const auto& [iterator, inserted] = _opened_files.emplace(filename, file_info_t{ std::move(f_ptr), mode, faber::io::filesize(*f_ptr) });
-    [[maybe_unused]] const auto& [key, info] = *iterator;
+    const auto size = faber::io::filesize(*f_ptr);
+    [[maybe_unused]] const auto& [iterator, inserted] = _opened_files.try_emplace(filename, std::move(f_ptr), mode, size);
+    [[maybe_unused]] auto& [key, info] = *iterator;
+    lru_push_front(info);
+    info.resident = true;
+    ++_open_streams;
+    if (hint != access_hint::normal) {
+        info.hint = hint;
+        advise_stream(*info.stream, key, hint);
+    }
+    if (_stats_enabled) {
+        info.stats = std::make_unique<file_stats>();
+        info.stream->record_into(info.stats.get());
+    }
+    if (_watcher) {
+        _watcher->track(key, info);
+    }
+    return *info.stream;
+}
+
+std::fstream& file_monitor::acquire(std::string_view filename, file_info_t& info) {
+    if (info.stream->is_open()) {
+        if (info.resident) {
+            lru_unlink(info);
+        } else {
+            // Reopened by hand after an eviction, counted again from now on.
+            reserve_slot();
+            info.resident = true;
+            ++_open_streams;
+        }
+        lru_push_front(info);
+        return *info.stream;
+    }
+
+    // Closed through the stream itself rather than the monitor: still counted and on
+    // the recency list, give its slot back before reopening it like an evicted one.
+    if (info.resident) {
+        lru_unlink(info);
+        info.resident = false;
+        --_open_streams;
+    }
+
+    // Evicted by the cache. Reopening must never truncate the file, and `out` on its
+    // own implies truncation, so the stream is reopened for reading as well.
+    auto mode = info.mode & ~std::fstream::trunc;
+    if ((mode & std::fstream::out) and not (mode & (std::fstream::in | std::fstream::app))) {
+        mode |= std::fstream::in;
+    }
+
+    reserve_slot();
+    info.stream->clear();
+    info.stream->borrow();
+    open_stream(*info.stream, std::string{filename}, mode);
+    if (info.position != std::streampos(-1)) {
+        info.stream->seekg(std::exchange(info.position, std::streampos(-1)));
+    }
+    if (info.hint != access_hint::normal) {
+        advise_stream(*info.stream, filename, info.hint);
+    }
+
+    lru_push_front(info);
+    info.resident = true;
+    ++_open_streams;
     return *info.stream;
+}
+
+void file_monitor::open_stream(std::fstream& stream, const std::string& filename, std::fstream::openmode mode) {
+    stream.open(filename, mode);
+
+    // Out of descriptors: in caching mode, make room by evicting and try again.
+    while (not stream and _capacity > 0 and (errno == EMFILE or errno == ENFILE) and evict_lru()) {
+        stream.clear();
+        stream.open(filename, mode);
+    }
 
-    // The alternative is this cursed one-liner with poor readability. Performance losses are practically nonexistent.
-    // return *_opened_files.emplace(filename, file_info_t{ std::move(f_ptr), mode, faber::io::filesize(*f_ptr) }).first->second.stream;
+    if (not stream) {
+        throw std::runtime_error{"error: could not open file"};
+    }
+}
+
+void file_monitor::lru_push_front(file_info_t& info) {
+    if (_capacity == 0) {
+        return; // only maintained in caching mode
+    }
+    info.lru_prev = nullptr;
+    info.lru_next = _lru_head;
+    if (_lru_head) { _lru_head->lru_prev = &info; }
+    _lru_head = &info;
+    if (not _lru_tail) { _lru_tail = &info; }
+}
+
+void file_monitor::lru_unlink(file_info_t& info) {
+    if (_capacity == 0) {
+        return;
+    }
+    if (info.lru_prev) { info.lru_prev->lru_next = info.lru_next; } else { _lru_head = info.lru_next; }
+    if (info.lru_next) { info.lru_next->lru_prev = info.lru_prev; } else { _lru_tail = info.lru_prev; }
+    info.lru_prev = info.lru_next = nullptr;
+}
+
+bool file_monitor::evict_lru() {
+    if (not _lru_tail) {
+        return false;
+    }
+
+    auto& info = *_lru_tail;
+    lru_unlink(info);
+
+    info.stream->clear(); // `tellg` fails on a stream with eofbit set
+    info.position = info.stream->tellg();
+    info.stream->close();
+    info.stream->give_back();
+    info.resident = false;
+    --_open_streams;
+    return true;
+}
+
+void file_monitor::reserve_slot() {
+    while (_capacity > 0 and _open_streams >= _capacity and evict_lru()) { }
 }
 
 /********** Public Member Functions **********/
@@ -68,22 +279,206 @@ std::fstream& file_monitor::open(const char* filename, std::fstream::openmode mo
     return open_impl(filename, mode);
 }
 
-void file_monitor::close(std::string_view filename) {
+std::fstream& file_monitor::open(const char* filename, std::fstream::openmode mode, access_hint hint) {
+    return open_impl(filename, mode, hint);
+}
+
+const faber::io::mapped_file& file_monitor::open_mapped(const char* filename, access_hint hint) {
+    const auto& mapping = open_mapped(filename);
+    advise(filename, hint);
+    return mapping;
+}
+
+const faber::io::mapped_file& file_monitor::open_mapped(const char* filename) {
+
+    // Already registered: map the file next to its stream, reusing the entry.
+    if (const auto it = _opened_files.find(filename); it != _opened_files.end()) {
+        auto& info = it->second;
+        if (not info.mapping.is_open() and not info.mapping.open(filename)) {
+            throw std::runtime_error{"error: could not map file"};
+        }
+        if (info.stats) {
+            info.stats->touch();
+        }
+        return info.mapping;
+    }
+
+    faber::io::mapped_file mapping{filename};
+    if (not mapping.is_open()) {
+        throw std::runtime_error{"error: could not map file"};
+    }
+
+    // Mapping-only entry, there is no stream associated to it.
+    const auto size = mapping.size();
+    [[maybe_unused]] const auto& [iterator, inserted] = _opened_files.try_emplace(filename, nullptr, std::fstream::in, size);
+    auto& [key, info] = *iterator;
+    info.mapping = std::move(mapping);
+    if (_stats_enabled) {
+        info.stats = std::make_unique<file_stats>();
+    }
+    if (_watcher) {
+        _watcher->track(key, info);
+    }
+    return info.mapping;
 }
 
-hashtable_t::const_iterator file_monitor::find(std::string_view filename) const {
+void file_monitor::close(path_ref filename) {
+    const auto it = _opened_files.find(filename);
+    if (it == _opened_files.end()) {
+        return;
+    }
+
+    if (auto& info = it->second; info.resident) {
+        lru_unlink(info);
+        --_open_streams;
+    }
+    if (_watcher) {
+        _watcher->untrack(it->first);
+    }
+    _opened_files.erase(it);
+}
+
+bool file_monitor::advise(path_ref filename, access_hint hint) {
+    auto& info = _opened_files.at(filename);
+    info.hint = hint;
+
+    bool advised = true;
+    if (info.stream and info.stream->is_open()) {
+        advised = advise_stream(*info.stream, filename.view(), hint);
+    }
+    if (info.mapping.is_open()) {
+        advised = info.mapping.advise(hint) and advised;
+    }
+    return advised;
+}
+
+std::size_t file_monitor::warm(const std::vector<std::string>& paths, std::fstream::openmode mode, access_hint hint, std::size_t threads) {
+    std::vector<std::string> pending{};
+    pending.reserve(paths.size());
+    for (const auto& path : paths) {
+        if (not _opened_files.contains(path)) {
+            pending.push_back(path);
+        }
+    }
+
+    // Every file is read in concurrently, opening them one by one is then cheap.
+    faber::io::prefetch(pending, threads);
+    std::size_t opened = 0;
+    for (const auto& path : pending) {
+        if (not _opened_files.contains(path)) { // listed twice
+            open_impl(path.c_str(), mode, hint);
+            ++opened;
+        }
+    }
+    return opened;
+}
+
+hashtable_t::const_iterator file_monitor::find(path_ref filename) const {
     return _opened_files.find(filename);
 }
 
-const file_info_t& file_monitor::operator[](const std::string_view key) const {
-    return _opened_files.at(key);
+const file_info_t& file_monitor::operator[](path_ref key) const {
+    const auto& info = _opened_files.at(key);
+    if (not info.stream) {
+        throw std::runtime_error{"error: file only mapped on monitor, it has no stream."};
+    }
+    return info;
 }
 
-file_info_t& file_monitor::operator[](const std::string_view key) {
+file_info_t& file_monitor::operator[](path_ref key) {
+    const auto it = _opened_files.find(key);
+    if (it == _opened_files.end()) {
+        throw std::out_of_range{"error: file not opened on monitor."};
+    }
+
+    auto& [filename, info] = *it;
+    if (not info.stream) {
+        throw std::runtime_error{"error: file only mapped on monitor, it has no stream."};
+    }
+    if (info.stats) {
+        info.stats->touch();
+    }
+    if (_capacity > 0 or not info.resident) {
+        // Without a capacity only streams evicted by the cache before it was disabled
+        // are reopened, a stream closed by hand stays closed.
+        acquire(filename, info);
+    }
+    return info;
 }
 
 const hashtable_t& file_monitor::data() const {
+    return _opened_files;
 }
 
 hashtable_t& file_monitor::data() {
+    return _opened_files;
+}
+
+void file_monitor::set_capacity(std::size_t max_open) {
+    if (max_open == 0) {
+        // Leaving caching mode, the recency list is no longer maintained.
+        for (auto* info = _lru_head; info;) {
+            info = std::exchange(info->lru_next, nullptr);
+            if (info) {
+                info->lru_prev = nullptr;
+            }
+        }
+        _lru_head = _lru_tail = nullptr;
+        _capacity = 0;
+        return;
+    }
+
+    const bool entering = (_capacity == 0);
+    _capacity = max_open;
+    if (entering) {
+        // Streams opened so far were never ranked, they enter the list in table order.
+        for (auto& [filename, info] : _opened_files) {
+            if (info.resident) {
+                lru_push_front(info);
+            }
+        }
+    }
+    while (_open_streams > _capacity and evict_lru()) { }
+}
+
+std::size_t file_monitor::capacity() const noexcept {
+    return _capacity;
+}
+
+std::size_t file_monitor::open_streams() const noexcept {
+    return _open_streams;
+}
+
+void file_monitor::enable_stats() {
+    if (_stats_enabled) {
+        return;
+    }
+    _stats_enabled = true;
+    for (auto& [filename, info] : _opened_files) {
+        if (not info.stats) {
+            info.stats = std::make_unique<file_stats>();
+        }
+        if (info.stream) {
+            info.stream->record_into(info.stats.get());
+        }
+    }
+}
+
+bool file_monitor::stats_enabled() const noexcept {
+    return _stats_enabled;
+}
+
+std::vector<std::pair<std::string, faber::io::file_stats_snapshot>> file_monitor::stats_snapshot() const {
+    std::vector<std::pair<std::string, file_stats_snapshot>> snapshot{};
+    if (not _stats_enabled) {
+        return snapshot;
+    }
+
+    snapshot.reserve(_opened_files.size());
+    for (const auto& [filename, info] : _opened_files) {
+        if (info.stats) {
+            snapshot.emplace_back(std::string{filename}, info.stats->load());
+        }
+    }
+    return snapshot;
 }
@@ -0,0 +1,78 @@
+/********** Headers **********/
+
+// POSIX
+#include <time.h>       // clock_gettime, CLOCK_REALTIME_COARSE
+
+// internal
+#include <file_stats.h>
+
+using file_stats            = faber::io::file_stats;
+using file_stats_snapshot   = faber::io::file_stats_snapshot;
+
+/********** file_stats.cpp **********/
+
+namespace {
+
+    file_stats_snapshot::time_point to_time_point(std::int64_t ns) noexcept {
+        using namespace std::chrono;
+        return file_stats_snapshot::time_point{duration_cast<system_clock::duration>(nanoseconds{ns})};
+    }
+
+} // namespace
+
+/********** Constructors & Destructor **********/
+
+file_stats::file_stats() noexcept {
+    const auto t = now();
+    _opened_at.store(t, std::memory_order_relaxed);
+    _last_access.store(t, std::memory_order_relaxed);
+}
+
+/********** Private Member Functions **********/
+
+std::int64_t file_stats::now() noexcept {
+    // Served from the vDSO without entering the kernel, with tick resolution.
+    timespec ts{};
+    ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+/********** Public Member Functions **********/
+
+file_stats_snapshot file_stats::load() const noexcept {
+    file_stats_snapshot snapshot{};
+    snapshot.opened_at      = to_time_point(_opened_at.load(std::memory_order_relaxed));
+    snapshot.last_access    = to_time_point(_last_access.load(std::memory_order_relaxed));
+    snapshot.accesses       = _accesses.load(std::memory_order_relaxed);
+    snapshot.reads          = _reads.load(std::memory_order_relaxed);
+    snapshot.writes         = _writes.load(std::memory_order_relaxed);
+    snapshot.bytes_read     = _bytes_read.load(std::memory_order_relaxed);
+    snapshot.bytes_written  = _bytes_written.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < latency_buckets; ++i) {
+        snapshot.read_latency[i]  = _read_latency[i].load(std::memory_order_relaxed);
+        snapshot.write_latency[i] = _write_latency[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+std::chrono::nanoseconds file_stats_snapshot::percentile(const histogram& h, double p) noexcept {
+    std::uint64_t total = 0;
+    for (const auto count : h) {
+        total += count;
+    }
+    if (total == 0) {
+        return std::chrono::nanoseconds{0};
+    }
+
+    // Out of range (or NaN) fractions would make the conversion below undefined.
+    p = (p > 0.0) ? std::min(p, 1.0) : 0.0;
+    const auto rank = static_cast<std::uint64_t>(p * static_cast<double>(total - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < h.size(); ++i) {
+        seen += h[i];
+        if (seen >= rank) {
+            return std::chrono::nanoseconds{std::int64_t{1} << i};
+        }
+    }
+    return std::chrono::nanoseconds{std::int64_t{1} << (h.size() - 1)};
+}
@@ -0,0 +1,389 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::find
+#include <cerrno>       // errno
+#include <stdexcept>    // std::runtime_error
+#include <string>       // std::string
+#include <utility>      // std::pair, std::move
+
+// POSIX
+#include <poll.h>           // poll
+#include <sys/inotify.h>    // inotify_init1, inotify_add_watch, inotify_rm_watch
+#include <sys/stat.h>       // stat
+#include <unistd.h>         // read, close
+
+// internal
+#include <file_watcher.h>
+
+using file_watcher = faber::io::file_watcher;
+using file_info_t  = faber::io::file_monitor::file_info_t;
+
+/********** file_watcher.cpp **********/
+
+namespace {
+
+    constexpr std::uint32_t watch_mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF;
+
+    /** Directories are only watched for the names of renamed or replaced files. */
+    constexpr std::uint32_t directory_mask = IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+    /** Room for a few hundred notifications per `read`. */
+    constexpr std::size_t event_buffer_size = 64 * 1024;
+
+    std::uint32_t to_mask(std::uint32_t inotify_mask) noexcept {
+        std::uint32_t mask = 0;
+        if (inotify_mask & IN_MODIFY)       { mask |= file_watcher::modified; }
+        if (inotify_mask & IN_ATTRIB)       { mask |= file_watcher::attributes; }
+        if (inotify_mask & IN_CLOSE_WRITE)  { mask |= file_watcher::closed_write; }
+        if (inotify_mask & IN_DELETE_SELF)  { mask |= file_watcher::removed; }
+        if (inotify_mask & IN_MOVE_SELF)    { mask |= file_watcher::moved; }
+        return mask;
+    }
+
+    std::chrono::system_clock::time_point to_time_point(const timespec& ts) noexcept {
+        using namespace std::chrono;
+        return system_clock::time_point{duration_cast<system_clock::duration>(seconds{ts.tv_sec} + nanoseconds{ts.tv_nsec})};
+    }
+
+    std::string parent_directory(std::string_view path) {
+        const auto slash = path.rfind('/');
+        if (slash == std::string_view::npos) {
+            return ".";
+        }
+        return std::string{slash == 0 ? path.substr(0, 1) : path.substr(0, slash)};
+    }
+
+    std::string_view base_name(std::string_view path) noexcept {
+        const auto slash = path.rfind('/');
+        return (slash == std::string_view::npos) ? path : path.substr(slash + 1);
+    }
+
+    std::string join(const std::string& directory, std::string_view name) {
+        if (directory == ".") {
+            return std::string{name};
+        }
+        return directory + (directory.back() == '/' ? "" : "/") + std::string{name};
+    }
+
+    /** Refreshes `info` from the file at `location`, `false` if it can't be `stat`ed anymore. */
+    bool update_metadata(const std::string& location, file_info_t& info) {
+        struct stat st{};
+        if (location.empty() or ::stat(location.c_str(), &st) == -1) {
+            return false;
+        }
+        info.size     = static_cast<decltype(info.size)>(st.st_size);
+        info.modified = to_time_point(st.st_mtim);
+        return true;
+    }
+
+} // namespace
+
+/********** Constructors & Destructor **********/
+
+file_watcher::file_watcher(file_monitor& monitor) : _monitor(monitor) {
+    if (_monitor._watcher) {
+        throw std::runtime_error{"error: monitor already has a watcher attached."};
+    }
+
+    _fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd == -1) {
+        throw std::runtime_error{"error: could not initialize inotify."};
+    }
+    _buffer.resize(event_buffer_size);
+
+    for (auto& [filename, info] : _monitor._opened_files) {
+        if (info.stream or info.mapping.is_open()) {
+            track(filename, info);
+        }
+    }
+    _monitor._watcher = this;
+}
+
+file_watcher::~file_watcher() {
+    _monitor._watcher = nullptr;
+    ::close(_fd); // drops every watch at once
+}
+
+/********** Private Member Functions **********/
+
+void file_watcher::track(std::string_view filename, file_info_t& info) {
+    const int wd = ::inotify_add_watch(_fd, std::string{filename}.c_str(), watch_mask);
+    if (wd == -1) {
+        return; // out of watches, or a file that can't be watched
+    }
+
+    auto& file = _files.insert_or_assign(filename, watched_file{ wd, -1, std::string{filename} }).first->second;
+    _paths[wd].push_back(filename);
+    watch_directory(filename);
+    update_metadata(file.location, info);
+}
+
+void file_watcher::untrack(std::string_view filename) {
+    const auto it = _files.find(filename);
+    if (it == _files.end()) {
+        return;
+    }
+
+    const auto [wd, directory, location] = std::move(it->second);
+    _files.erase(it);
+    release_directory(directory);
+    detach(filename, wd);
+}
+
+void file_watcher::detach(std::string_view filename, int wd) {
+    const auto it = _paths.find(wd);
+    if (it == _paths.end()) {
+        return; // already dropped by the kernel
+    }
+    auto& paths = it->second;
+    paths.erase(std::find(paths.begin(), paths.end(), filename));
+    if (paths.empty()) {
+        _paths.erase(it);
+        ::inotify_rm_watch(_fd, wd);
+    }
+}
+
+int file_watcher::rewatch(std::string_view filename) {
+    auto& file = _files.at(filename);
+    if (file.location.empty()) {
+        return -1;
+    }
+
+    // The kernel hands out the descriptor it already has for the inode, a different
+    // one means another file now lives at the location.
+    const int wd = ::inotify_add_watch(_fd, file.location.c_str(), watch_mask);
+    if (wd == -1 or wd == file.wd) {
+        return -1;
+    }
+    detach(filename, file.wd);
+    file.wd = wd;
+    _paths[wd].push_back(filename);
+    return wd;
+}
+
+void file_watcher::refresh(std::string_view filename, std::uint32_t mask, std::vector<event>& events) {
+    auto& info = _monitor._opened_files.at(filename);
+    const auto& file = _files.at(filename);
+    if (not update_metadata(file.location, info)) {
+        mask |= removed;
+    }
+    events.push_back(event{ filename, mask, info.size, info.modified, file.location });
+}
+
+void file_watcher::watch_directory(std::string_view filename) {
+    auto& file = _files.at(filename);
+    auto path  = parent_directory(file.location);
+
+    // Shared by every file of the directory, the kernel hands out the same descriptor.
+    const int wd = ::inotify_add_watch(_fd, path.c_str(), directory_mask);
+    if (wd == -1) {
+        file.directory = -1; // renames won't be followed
+        return;
+    }
+    ++_directories.try_emplace(wd, watched_directory{ std::move(path), 0 }).first->second.files;
+    file.directory = wd;
+}
+
+void file_watcher::release_directory(int wd) {
+    const auto it = _directories.find(wd);
+    if (it == _directories.end()) {
+        return;
+    }
+    if (--it->second.files == 0) {
+        _directories.erase(it);
+        ::inotify_rm_watch(_fd, wd);
+    }
+}
+
+void file_watcher::relocate(int from, std::string_view from_name, int to, std::string_view to_name) {
+    // Renames are rare, a scan of the watched files is cheaper than another index.
+    for (auto& [filename, file] : _files) {
+        if (file.directory != from or base_name(file.location) != from_name) {
+            continue;
+        }
+        auto& destination = _directories.at(to);
+        file.location = join(destination.path, to_name);
+        if (to != from) {
+            ++destination.files;
+            release_directory(from);
+            file.directory = to;
+        }
+    }
+}
+
+void file_watcher::lose(int from, std::string_view from_name) {
+    for (auto& [filename, file] : _files) {
+        if (file.directory == from and base_name(file.location) == from_name) {
+            release_directory(from);
+            file.directory = -1;
+            file.location.clear();
+        }
+    }
+}
+
+/********** Public Member Functions **********/
+
+std::size_t file_watcher::poll(std::vector<event>& events, int timeout_ms) {
+    if (timeout_ms != 0) {
+        pollfd pfd{ _fd, POLLIN, 0 };
+        while (::poll(&pfd, 1, timeout_ms) == -1 and errno == EINTR) { }
+    }
+
+    // Drain the queue first, so every file is `stat`ed once however busy it was.
+    std::unordered_map<int, std::uint32_t> pending{};
+    std::vector<int> order{};
+    std::vector<int> dropped{};
+    std::unordered_map<std::uint32_t, std::pair<int, std::string>> moves{}; // renames seen leaving a directory, by cookie
+    bool overflow = false;
+
+    const auto mark = [&](int wd, std::uint32_t mask) {
+        auto [it, inserted] = pending.try_emplace(wd, 0U);
+        if (inserted) {
+            order.push_back(wd);
+        }
+        it->second |= mask;
+    };
+
+    for (;;) {
+        const auto n = ::read(_fd, _buffer.data(), _buffer.size());
+        if (n <= 0) {
+            if (n == -1 and errno == EINTR) { continue; }
+            break; // EAGAIN, nothing left
+        }
+
+        for (std::size_t offset = 0; offset < static_cast<std::size_t>(n); ) {
+            const auto* e = reinterpret_cast<const inotify_event*>(_buffer.data() + offset);
+            offset += sizeof(inotify_event) + e->len;
+
+            if (e->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            if (_directories.contains(e->wd)) {
+                // Both halves of a rename share a cookie, the file moved from one name to the other.
+                if (e->mask & IN_MOVED_FROM) {
+                    moves.insert_or_assign(e->cookie, std::pair{ e->wd, std::string{e->name} });
+                } else if (e->mask & (IN_MOVED_TO | IN_CREATE)) {
+                    if (const auto it = moves.find(e->cookie); (e->mask & IN_MOVED_TO) and it != moves.end()) {
+                        relocate(it->second.first, it->second.second, e->wd, e->name);
+                        moves.erase(it);
+                    }
+
+                    // A new file under a watched name (atomic rename over it, or removal
+                    // and creation) replaces the watched one, which is followed there.
+                    for (auto& [filename, file] : _files) {
+                        if (file.directory == e->wd and base_name(file.location) == e->name) {
+                            if (const int wd = rewatch(filename); wd != -1) {
+                                mark(wd, modified);
+                            }
+                        }
+                    }
+                } else if (e->mask & IN_IGNORED) {
+                    // Directory removed, its files can't be followed anymore.
+                    for (auto& [filename, file] : _files) {
+                        if (file.directory == e->wd) {
+                            file.directory = -1;
+                        }
+                    }
+                    _directories.erase(e->wd);
+                }
+                continue;
+            }
+            if (not _paths.contains(e->wd)) {
+                continue; // already untracked
+            }
+
+            mark(e->wd, to_mask(e->mask));
+            if (e->mask & IN_IGNORED) {
+                dropped.push_back(e->wd); // the kernel dropped the watch
+            }
+        }
+    }
+
+    // Renamed into a directory that isn't watched, the new name is unknown.
+    for (const auto& [cookie, source] : moves) {
+        lose(source.first, source.second);
+    }
+
+    // A dropped file that still exists at its location was replaced rather than
+    // removed, the new file is watched instead. The others are forgotten once reported.
+    for (const int wd : dropped) {
+        const auto it = _paths.find(wd);
+        if (it == _paths.end()) {
+            continue;
+        }
+        const auto mask  = pending[wd];
+        const auto paths = it->second; // edited by `rewatch`
+        for (const auto& path : paths) {
+            if (const int replacement = rewatch(path); replacement != -1) {
+                mark(replacement, (mask & ~removed) | modified);
+            }
+        }
+        if (_paths.contains(wd)) {
+            pending[wd] |= removed;
+        }
+    }
+
+    if (overflow) {
+        // Notifications were lost, replacements included.
+        for (const auto& [filename, file] : _files) {
+            if (const int wd = rewatch(filename); wd != -1) {
+                mark(wd, modified);
+            }
+        }
+    }
+
+    const auto first = events.size();
+    for (const int wd : order) {
+        const auto it = _paths.find(wd);
+        if (it == _paths.end()) {
+            continue; // every file moved to another watch
+        }
+        for (const auto& path : it->second) {
+            refresh(path, pending[wd], events);
+        }
+    }
+    for (const int wd : dropped) {
+        if (const auto it = _paths.find(wd); it != _paths.end()) {
+            // Kept until closed on the monitor, the events above point to their location.
+            for (const auto& path : it->second) {
+                _files.at(path).wd = -1;
+            }
+            _paths.erase(it);
+        }
+    }
+
+    if (overflow) {
+        // Notifications were lost, every other watched file may have changed too.
+        for (const auto& [wd, paths] : _paths) {
+            if (pending.contains(wd)) {
+                continue;
+            }
+            for (const auto& path : paths) {
+                refresh(path, rescanned, events);
+            }
+        }
+    }
+    return events.size() - first;
+}
+
+std::size_t file_watcher::dispatch(const event_callback& callback, int timeout_ms) {
+    std::vector<event> events{};
+    if (poll(events, timeout_ms) > 0) {
+        callback(events);
+    }
+    return events.size();
+}
+
+int file_watcher::native_handle() const noexcept {
+    return _fd;
+}
+
+std::size_t file_watcher::watched() const noexcept {
+    std::size_t count = 0;
+    for (const auto& [wd, paths] : _paths) {
+        count += paths.size();
+    }
+    return count;
+}
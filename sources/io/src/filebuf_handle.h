@@ -0,0 +1,36 @@
+#ifndef FABER_FILEBUF_HANDLE_H
+#define FABER_FILEBUF_HANDLE_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <fstream>  // std::fstream
+
+/********** filebuf_handle.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /** Implementation details, internal to the library. */
+        namespace impl_details {
+
+            /**
+             * Returns the descriptor behind an open stream, for system calls the stream
+             * doesn't wrap. The stream keeps ownership of it. Relies on libstdc++
+             * internals, callers must handle -1 with a fallback of their own.
+             *
+             * @returns The descriptor, or -1 if the stream isn't open or the standard
+             *          library doesn't expose it.
+            */
+            int
+            native_handle(std::fstream& file);
+
+        } // namespace impl_details
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_FILEBUF_HANDLE_H
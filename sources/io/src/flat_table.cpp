@@ -0,0 +1,107 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <cstring>      // std::memcpy
+
+// internal
+#include <flat_table.h>
+
+using path_arena = faber::io::path_arena;
+
+/********** flat_table.cpp **********/
+
+/********** path_arena **********/
+
+path_arena::path_arena(std::pmr::memory_resource* resource) noexcept
+    : _resource(resource), _blocks(resource), _free(resource), _unused(resource) { }
+
+path_arena::~path_arena() {
+    clear();
+}
+
+char* path_arena::allocate(std::size_t size) {
+    return static_cast<char*>(_resource->allocate(size, alignof(char)));
+}
+
+void path_arena::deallocate(block& b) noexcept {
+    if (b.data) {
+        _resource->deallocate(b.data, b.size, alignof(char));
+    }
+    b.data = nullptr;
+    b.size = 0;
+}
+
+path_arena::interned path_arena::intern(std::string_view path) {
+    const std::size_t needed = path.size() + 1; // NUL-terminated
+
+    std::uint32_t id{};
+    if (needed > block_size) {
+        // Oversized paths get a dedicated block, leaving the current one untouched.
+        if (not _unused.empty()) {
+            id = _unused.back();
+            _unused.pop_back();
+        } else {
+            id = static_cast<std::uint32_t>(_blocks.size());
+            _blocks.emplace_back();
+        }
+        _blocks[id].data = allocate(needed);
+        _blocks[id].size = needed;
+    } else {
+        if (_current == UINT32_MAX or _blocks[_current].size - _blocks[_current].used < needed) {
+            if (not _free.empty()) {
+                _current = _free.back();
+                _free.pop_back();
+            } else {
+                _current = static_cast<std::uint32_t>(_blocks.size());
+                _blocks.push_back(block{ allocate(block_size), block_size, 0, 0 });
+            }
+        }
+        id = _current;
+    }
+
+    auto& b = _blocks[id];
+    char* dst = b.data + b.used;
+    std::memcpy(dst, path.data(), path.size());
+    dst[path.size()] = '\0';
+    b.used += needed;
+    ++b.live;
+
+    return {std::string_view{dst, path.size()}, id};
+}
+
+void path_arena::release(const interned& path) {
+    auto& b = _blocks[path.block];
+    if (--b.live > 0) {
+        return;
+    }
+
+    // Last path of the block, recycle it.
+    b.used = 0;
+    if (path.block == _current) {
+        return;
+    }
+    if (b.size == block_size) {
+        _free.push_back(path.block);
+    } else {
+        deallocate(b);
+        _unused.push_back(path.block);
+    }
+}
+
+void path_arena::clear() {
+    for (auto& b : _blocks) {
+        deallocate(b);
+    }
+    _blocks.clear();
+    _free.clear();
+    _unused.clear();
+    _current = UINT32_MAX;
+}
+
+std::size_t path_arena::capacity() const noexcept {
+    std::size_t total = 0;
+    for (const auto& b : _blocks) {
+        total += b.size;
+    }
+    return total;
+}
@@ -0,0 +1,407 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::min, std::max
+#include <atomic>       // std::atomic
+#include <iostream>     // std::cerr
+#include <cerrno>       // errno
+#include <cstdint>      // std::uint64_t
+#include <vector>       // std::vector
+
+// POSIX
+#include <fcntl.h>          // open, readahead, posix_fadvise
+#include <linux/fs.h>       // FICLONE
+#include <stdio.h>          // renameat2, RENAME_NOREPLACE
+#include <sys/ioctl.h>      // ioctl
+#include <sys/sendfile.h>   // sendfile
+#include <sys/stat.h>       // stat, fstat, fchmod
+#include <unistd.h>         // read, close, copy_file_range, pread, pwrite, ftruncate, unlink
+
+// internal
+#include <io.h>
+#include "filebuf_handle.h"
+#include "unique_fd.h"
+
+namespace io = faber::io;
+namespace fs = io::fs;
+namespace impl_details = faber::io::impl_details;
+
+/********** io.cpp **********/
+
+/********** Internal Helpers **********/
+
+namespace {
+
+#if defined(__GLIBCXX__)
+    /** libstdc++ keeps the descriptor of a `std::filebuf` in a protected member. */
+    struct filebuf_access : std::filebuf {
+        static int fd(std::filebuf& buffer) {
+            return (buffer.*(&filebuf_access::_M_file)).fd();
+        }
+    };
+#endif
+
+    /**
+     * Reads from `fd` until `capacity` bytes were read or end of file is reached,
+     * retrying on interruptions.
+     *
+     * @returns The number of bytes read or -1 on error.
+    */
+    ssize_t read_fully(int fd, std::byte* dst, std::size_t capacity) {
+        std::size_t total = 0;
+        while (total < capacity) {
+            const ssize_t n = ::read(fd, dst + total, capacity - total);
+            if (n == 0) { break; }
+            if (n == -1) {
+                if (errno == EINTR) { continue; }
+                return -1;
+            }
+            total += static_cast<std::size_t>(n);
+        }
+        return static_cast<ssize_t>(total);
+    }
+
+    /**
+     * Shared implementation of the `io::read_all` overloads. `Container` must be a
+     * contiguous container of byte-sized elements.
+    */
+    template<typename Container>
+    bool read_all_impl(const std::string& filename, Container& out) {
+        const impl_details::unique_fd fd{::open(filename.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (not fd) {
+            std::cerr << "[ERROR] Failed to open file `" << filename << "`\n";
+            return false;
+        }
+
+        struct stat st{};
+        if (::fstat(fd.get(), &st) == -1) {
+            std::cerr << "[ERROR] Failed to stat file `" << filename << "`\n";
+            return false;
+        }
+
+        out.resize(static_cast<std::size_t>(st.st_size));
+        const ssize_t n = read_fully(fd.get(), reinterpret_cast<std::byte*>(out.data()), out.size());
+
+        if (n == -1) {
+            std::cerr << "[ERROR] Failed to read file `" << filename << "`\n";
+            out.clear();
+            return false;
+        }
+
+        // The file may have been truncated since `fstat`, never expose stale bytes.
+        out.resize(static_cast<std::size_t>(n));
+        return true;
+    }
+
+    /** Creates the directory `path` lives in, if it doesn't exist yet. */
+    bool ensure_parent(const fs::path& path) {
+        const auto parent = path.parent_path();
+        std::error_code ec{};
+        return parent.empty() or fs::is_directory(parent, ec) or io::try_mkdirs(parent);
+    }
+
+    enum class copy_status { done, unsupported, failed };
+
+    bool unsupported(int error) noexcept {
+        return error == EXDEV or error == ENOSYS or error == EOPNOTSUPP or error == EINVAL;
+    }
+
+    /**
+     * Copies `[offset, offset + length)` with `copy_file_range`. Both offsets are
+     * explicit, so disjoint ranges of the same pair of files may be copied
+     * concurrently. `unsupported` is only reported if nothing was copied.
+    */
+    copy_status copy_range_kernel(int in, int out, std::uint64_t offset, std::uint64_t length) {
+        auto off_in  = static_cast<loff_t>(offset);
+        auto off_out = static_cast<loff_t>(offset);
+        bool copied  = false;
+        while (length > 0) {
+            const ssize_t n = ::copy_file_range(in, &off_in, out, &off_out, length, 0);
+            if (n == -1) {
+                if (errno == EINTR) { continue; }
+                return (not copied and unsupported(errno)) ? copy_status::unsupported : copy_status::failed;
+            }
+            if (n == 0) { break; } // source truncated meanwhile
+            length -= static_cast<std::uint64_t>(n);
+            copied  = true;
+        }
+        return copy_status::done;
+    }
+
+    /** `sendfile` writes at the output's file position, not usable for concurrent chunks. */
+    copy_status copy_range_sendfile(int in, int out, std::uint64_t offset, std::uint64_t length) {
+        if (::lseek(out, static_cast<off_t>(offset), SEEK_SET) == -1) {
+            return copy_status::failed;
+        }
+        auto off_in = static_cast<off_t>(offset);
+        bool copied = false;
+        while (length > 0) {
+            const ssize_t n = ::sendfile(out, in, &off_in, length);
+            if (n == -1) {
+                if (errno == EINTR) { continue; }
+                return (not copied and unsupported(errno)) ? copy_status::unsupported : copy_status::failed;
+            }
+            if (n == 0) { break; }
+            length -= static_cast<std::uint64_t>(n);
+            copied  = true;
+        }
+        return copy_status::done;
+    }
+
+    bool copy_range_buffered(int in, int out, std::uint64_t offset, std::uint64_t length) {
+        std::vector<std::byte> buffer(std::min<std::uint64_t>(length, 1024 * 1024));
+        while (length > 0) {
+            const ssize_t n = ::pread(in, buffer.data(), std::min<std::uint64_t>(length, buffer.size()), static_cast<off_t>(offset));
+            if (n == -1) {
+                if (errno == EINTR) { continue; }
+                return false;
+            }
+            if (n == 0) { break; }
+            for (ssize_t done = 0; done < n; ) {
+                const ssize_t w = ::pwrite(out, buffer.data() + done, static_cast<std::size_t>(n - done), static_cast<off_t>(offset) + done);
+                if (w == -1) {
+                    if (errno == EINTR) { continue; }
+                    return false;
+                }
+                done += w;
+            }
+            offset += static_cast<std::uint64_t>(n);
+            length -= static_cast<std::uint64_t>(n);
+        }
+        return true;
+    }
+
+    /** Best available in-kernel copy of a range, `concurrent` if other ranges are being copied meanwhile. */
+    bool copy_range(int in, int out, std::uint64_t offset, std::uint64_t length, bool concurrent) {
+        auto status = copy_range_kernel(in, out, offset, length);
+        if (status == copy_status::unsupported and not concurrent) {
+            status = copy_range_sendfile(in, out, offset, length);
+        }
+        if (status == copy_status::unsupported) {
+            return copy_range_buffered(in, out, offset, length);
+        }
+        return status == copy_status::done;
+    }
+
+    bool copy_contents(int in, int out, std::uint64_t size, const io::copy_options& options) {
+        if (options.reflink and ::ioctl(out, FICLONE, in) == 0) {
+            return true;
+        }
+
+        const auto chunk = std::max<std::uint64_t>(options.chunk_size, 1);
+        if (size < options.parallel_threshold or size <= chunk) {
+            return copy_range(in, out, 0, size, false);
+        }
+
+        // Chunks land at their own offsets, in any order.
+        if (::ftruncate(out, static_cast<off_t>(size)) == -1) {
+            return false;
+        }
+
+        struct context_type {
+            int             in;
+            int             out;
+            std::uint64_t   size;
+            std::uint64_t   chunk;
+        } context{ in, out, size, chunk };
+
+        const impl_details::chunk_task task = [](void* ctx, std::size_t index) -> bool {
+            const auto& c = *static_cast<context_type*>(ctx);
+            const auto offset = index * c.chunk;
+            return copy_range(c.in, c.out, offset, std::min(c.chunk, c.size - offset), true);
+        };
+        return impl_details::run_chunks((size + chunk - 1) / chunk, options.threads, task, &context);
+    }
+
+} // namespace
+
+/********** API **********/
+
+bool io::try_mkdirs(const fs::path& dir) {
+    std::error_code ec{};
+    if (not fs::create_directories(dir, ec)) {
+        std::cerr <<
+            "[ERROR] Failed to create directory(ies)\n"
+            "\tReason: " << ec.message() << "\n"
+        << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool io::copy_file(const fs::path& from, const fs::path& to, const copy_options& options) {
+    const impl_details::unique_fd in{::open(from.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (not in) {
+        std::cerr << "[ERROR] Failed to open file `" << from.native() << "`\n";
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(in.get(), &st) == -1 or not S_ISREG(st.st_mode)) {
+        std::cerr << "[ERROR] Not a regular file `" << from.native() << "`\n";
+        return false;
+    }
+
+    if (not ensure_parent(to)) {
+        return false;
+    }
+
+    // Not truncated on open: copying a file onto itself must not destroy it. Only a
+    // destination created here is removed if the copy fails.
+    bool created = true;
+    impl_details::unique_fd out{::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777)};
+    if (not out and errno == EEXIST and options.overwrite) {
+        created = false;
+        out.reset(::open(to.c_str(), O_WRONLY | O_CLOEXEC));
+    }
+    if (not out) {
+        std::cerr << "[ERROR] Failed to open file `" << to.native() << "`\n";
+        return false;
+    }
+
+    struct stat st_out{};
+    if (::fstat(out.get(), &st_out) == 0 and st_out.st_dev == st.st_dev and st_out.st_ino == st.st_ino) {
+        return true;
+    }
+
+    // `open` ignores the mode of an existing file and applies the umask to a new one,
+    // the permissions are set explicitly either way.
+    bool ok = ::fchmod(out.get(), st.st_mode & 07777) == 0
+        and ::ftruncate(out.get(), 0) == 0
+        and copy_contents(in.get(), out.get(), static_cast<std::uint64_t>(st.st_size), options);
+    ok = (::close(out.release()) == 0) and ok;
+
+    if (not ok) {
+        std::cerr << "[ERROR] Failed to copy `" << from.native() << "` to `" << to.native() << "`\n";
+        if (created) {
+            ::unlink(to.c_str());
+        }
+    }
+    return ok;
+}
+
+bool io::transfer(const fs::path& from, const fs::path& to, const copy_options& options) {
+    if (not ensure_parent(to)) {
+        return false;
+    }
+
+    const unsigned flags = options.overwrite ? 0 : RENAME_NOREPLACE;
+    if (::renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), flags) == 0) {
+        return true;
+    }
+    if (errno != EXDEV and not (errno == EINVAL and flags != 0)) {
+        std::cerr << "[ERROR] Failed to move `" << from.native() << "` to `" << to.native() << "`\n";
+        return false;
+    }
+
+    // Different filesystems, or one without `RENAME_NOREPLACE` support (NFS, older
+    // FUSE...): the data has to be copied, `copy_file` still refuses to overwrite.
+    if (not copy_file(from, to, options)) {
+        return false;
+    }
+    if (::unlink(from.c_str()) == -1) {
+        std::cerr << "[ERROR] Failed to remove file `" << from.native() << "`\n";
+        return false;
+    }
+    return true;
+}
+
+int impl_details::native_handle(std::fstream& file) {
+#if defined(__GLIBCXX__)
+    return filebuf_access::fd(*file.rdbuf());
+#else
+    return -1;
+#endif
+}
+
+std::size_t io::filesize(std::fstream& file) {
+    // A single `fstat`, seeking would throw the read buffer away.
+    if (const int fd = impl_details::native_handle(file); fd != -1 and file.rdbuf()->pubsync() == 0) {
+        struct stat st{};
+        if (::fstat(fd, &st) == 0) {
+            return static_cast<std::size_t>(st.st_size);
+        }
+    }
+
+    const auto cur = file.tellg();
+
+    file.seekg(0, file.end);
+    const auto size = file.tellg();
+
+    file.seekg(cur);
+
+    return size;
+}
+
+std::size_t io::filesize(const std::string& filename) {
+    struct stat st{};
+    if (::stat(filename.c_str(), &st) == -1) {
+        return 0;
+    }
+    return static_cast<std::size_t>(st.st_size);
+}
+
+bool io::read_all(const std::string& filename, std::string& out) {
+    return read_all_impl(filename, out);
+}
+
+bool io::read_all(const std::string& filename, std::vector<std::byte>& out) {
+    return read_all_impl(filename, out);
+}
+
+bool io::read_into(const std::string& filename, std::span<std::byte> buffer, std::size_t& bytes_read) {
+    bytes_read = 0;
+
+    const impl_details::unique_fd fd{::open(filename.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (not fd) {
+        std::cerr << "[ERROR] Failed to open file `" << filename << "`\n";
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd.get(), &st) == -1) {
+        std::cerr << "[ERROR] Failed to stat file `" << filename << "`\n";
+        return false;
+    }
+
+    if (static_cast<std::size_t>(st.st_size) > buffer.size()) {
+        std::cerr << "[ERROR] Buffer too small for file `" << filename << "`\n";
+        return false;
+    }
+
+    const ssize_t n = read_fully(fd.get(), buffer.data(), static_cast<std::size_t>(st.st_size));
+
+    if (n == -1) {
+        std::cerr << "[ERROR] Failed to read file `" << filename << "`\n";
+        return false;
+    }
+
+    bytes_read = static_cast<std::size_t>(n);
+    return true;
+}
+
+std::size_t io::prefetch(const std::vector<std::string>& paths, std::size_t threads) {
+    struct context_type {
+        const std::vector<std::string>& paths;
+        std::atomic<std::size_t>        prefetched{0};
+    } context{ paths };
+
+    const impl_details::chunk_task task = [](void* ctx, std::size_t index) -> bool {
+        auto& c = *static_cast<context_type*>(ctx);
+        const impl_details::unique_fd fd{::open(c.paths[index].c_str(), O_RDONLY | O_CLOEXEC)};
+        if (not fd) {
+            return true;
+        }
+        struct stat st{};
+        if (::fstat(fd.get(), &st) == 0 and S_ISREG(st.st_mode)) {
+            // `readahead` queues the reads and returns, fall back to the generic hint.
+            if (::readahead(fd.get(), 0, static_cast<std::size_t>(st.st_size)) == 0
+                or ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_WILLNEED) == 0) {
+                c.prefetched.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return true;
+    };
+    impl_details::run_chunks(paths.size(), threads, task, &context);
+    return context.prefetched.load();
+}
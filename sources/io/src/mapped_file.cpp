@@ -0,0 +1,117 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <utility>      // std::exchange
+
+// POSIX
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, munmap, madvise
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close
+
+// internal
+#include <mapped_file.h>
+
+using mapped_file = faber::io::mapped_file;
+
+/********** mapped_file.cpp **********/
+
+/********** Constructors & Destructor **********/
+
+mapped_file::mapped_file(const std::string& filename) {
+    open(filename);
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : _data(std::exchange(other._data, nullptr))
+    , _size(std::exchange(other._size, 0))
+    , _open(std::exchange(other._open, false)) { }
+
+mapped_file::~mapped_file() {
+    close();
+}
+
+/********** Public Member Functions **********/
+
+bool mapped_file::open(const std::string& filename) {
+    close();
+
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) == -1) {
+        ::close(fd);
+        return false;
+    }
+
+    // `mmap` rejects zero-length mappings, an empty file is represented by an open
+    // handle with no data instead.
+    if (st.st_size > 0) {
+        void* addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        _data = static_cast<const std::byte*>(addr);
+        _size = static_cast<std::size_t>(st.st_size);
+    }
+
+    // The mapping keeps its own reference to the file, the descriptor is no longer needed.
+    ::close(fd);
+    _open = true;
+    return true;
+}
+
+void mapped_file::close() {
+    if (_data) {
+        ::munmap(const_cast<std::byte*>(_data), _size);
+    }
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+
+bool mapped_file::is_open() const noexcept {
+    return _open;
+}
+
+const std::byte* mapped_file::data() const noexcept {
+    return _data;
+}
+
+std::size_t mapped_file::size() const noexcept {
+    return _size;
+}
+
+std::span<const std::byte> mapped_file::bytes() const noexcept {
+    return {_data, _size};
+}
+
+bool mapped_file::advise(access_hint hint) const noexcept {
+    if (not _data) {
+        return true;
+    }
+
+    int advice = MADV_NORMAL;
+    switch (hint) {
+        case access_hint::normal:     advice = MADV_NORMAL;     break;
+        case access_hint::sequential: advice = MADV_SEQUENTIAL; break;
+        case access_hint::random:     advice = MADV_RANDOM;     break;
+        case access_hint::willneed:   advice = MADV_WILLNEED;   break;
+        case access_hint::dontneed:   advice = MADV_DONTNEED;   break;
+    }
+    return ::madvise(const_cast<std::byte*>(_data), _size, advice) == 0;
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+    if (this != &other) {
+        close();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+        _open = std::exchange(other._open, false);
+    }
+    return *this;
+}
@@ -0,0 +1,205 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>        // std::min
+#include <atomic>           // std::atomic
+#include <string_view>      // std::string_view
+#include <unordered_map>    // std::unordered_map
+#include <unordered_set>    // std::unordered_set
+
+// C stdlib
+#include <cerrno>       // errno, ENOSYS, ENOENT, ENOTDIR
+
+// POSIX
+#include <fcntl.h>          // AT_FDCWD, AT_STATX_SYNC_AS_STAT
+#include <sys/stat.h>       // statx, stat
+#include <sys/sysmacros.h>  // makedev
+
+// internal
+#include <metadata.h>
+#include <thread_pool.h>
+
+namespace io = faber::io;
+namespace fs = std::filesystem;
+
+using metadata_cache = faber::io::metadata_cache;
+using file_metadata  = faber::io::file_metadata;
+
+/********** metadata.cpp **********/
+
+/********** Internal Helpers **********/
+
+namespace {
+
+    /** Paths per chunk handed to a thread, a single `statx` is too short to be worth a `fetch_add`. */
+    constexpr std::size_t batch_grain = 32;
+
+    /** Set once `statx` is known to be unavailable (pre-4.11 kernel, seccomp filter). */
+    std::atomic<bool> statx_unavailable{false};
+
+    fs::file_type to_type(unsigned mode) noexcept {
+        switch (mode & S_IFMT) {
+            case S_IFREG:  return fs::file_type::regular;
+            case S_IFDIR:  return fs::file_type::directory;
+            case S_IFLNK:  return fs::file_type::symlink;
+            case S_IFBLK:  return fs::file_type::block;
+            case S_IFCHR:  return fs::file_type::character;
+            case S_IFIFO:  return fs::file_type::fifo;
+            case S_IFSOCK: return fs::file_type::socket;
+            default:       return fs::file_type::unknown;
+        }
+    }
+
+    file_metadata::time_point to_time_point(std::int64_t sec, std::int64_t nsec) noexcept {
+        using namespace std::chrono;
+        return file_metadata::time_point{duration_cast<system_clock::duration>(seconds{sec} + nanoseconds{nsec})};
+    }
+
+    file_metadata failed(int error) noexcept {
+        file_metadata m{};
+        m.error = error;
+        m.type  = (error == ENOENT or error == ENOTDIR) ? fs::file_type::not_found : fs::file_type::none;
+        return m;
+    }
+
+    file_metadata query(const char* path) noexcept {
+        if (not statx_unavailable.load(std::memory_order_relaxed)) {
+            struct statx st{};
+            constexpr unsigned mask = STATX_TYPE | STATX_SIZE | STATX_MTIME | STATX_INO;
+            if (::statx(AT_FDCWD, path, AT_STATX_SYNC_AS_STAT, mask, &st) == 0) {
+                file_metadata m{};
+                m.size     = st.stx_size;
+                m.modified = to_time_point(st.stx_mtime.tv_sec, st.stx_mtime.tv_nsec);
+                m.inode    = st.stx_ino;
+                m.device   = makedev(st.stx_dev_major, st.stx_dev_minor);
+                m.type     = to_type(st.stx_mode);
+                return m;
+            }
+            if (errno != ENOSYS) {
+                return failed(errno);
+            }
+            statx_unavailable.store(true, std::memory_order_relaxed);
+        }
+
+        struct stat st{};
+        if (::stat(path, &st) == -1) {
+            return failed(errno);
+        }
+        file_metadata m{};
+        m.size     = static_cast<std::uint64_t>(st.st_size);
+        m.modified = to_time_point(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+        m.inode    = st.st_ino;
+        m.device   = st.st_dev;
+        m.type     = to_type(st.st_mode);
+        return m;
+    }
+
+    /** Queries `paths` into `out` (same size), on up to `threads` threads. */
+    void query_all(const std::vector<const char*>& paths, std::vector<file_metadata>& out, std::size_t threads) {
+        struct context_type {
+            const std::vector<const char*>& paths;
+            std::vector<file_metadata>&     out;
+        } context{ paths, out };
+
+        const faber::io::impl_details::chunk_task task = [](void* ctx, std::size_t batch) -> bool {
+            auto& c = *static_cast<context_type*>(ctx);
+            const auto first = batch * batch_grain;
+            const auto last  = std::min(first + batch_grain, c.paths.size());
+            for (auto i = first; i < last; ++i) {
+                c.out[i] = query(c.paths[i]);
+            }
+            return true;
+        };
+        faber::io::impl_details::run_chunks((paths.size() + batch_grain - 1) / batch_grain, threads, task, &context);
+    }
+
+} // namespace
+
+/********** API **********/
+
+std::vector<file_metadata> io::stat_files(const std::vector<std::string>& paths, std::size_t threads) {
+    // A path listed several times is queried once, its result copied to every position.
+    std::vector<const char*> c_paths{};
+    std::vector<std::size_t> query_of(paths.size());
+    std::unordered_map<std::string_view, std::size_t> seen{};
+    c_paths.reserve(paths.size());
+    seen.reserve(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        const auto [it, inserted] = seen.try_emplace(paths[i], c_paths.size());
+        if (inserted) {
+            c_paths.push_back(paths[i].c_str());
+        }
+        query_of[i] = it->second;
+    }
+
+    std::vector<file_metadata> unique(c_paths.size());
+    query_all(c_paths, unique, threads);
+    if (unique.size() == paths.size()) {
+        return unique;
+    }
+
+    std::vector<file_metadata> metadata(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        metadata[i] = unique[query_of[i]];
+    }
+    return metadata;
+}
+
+/********** metadata_cache **********/
+
+metadata_cache::metadata_cache(std::size_t threads) noexcept : _threads(threads) { }
+
+std::size_t metadata_cache::store(const std::vector<std::string>& paths, bool missing_only) {
+    std::vector<const char*> pending{};
+    std::unordered_set<std::string_view> seen{}; // duplicates are queried once
+    pending.reserve(paths.size());
+    seen.reserve(paths.size());
+    for (const auto& path : paths) {
+        if ((not missing_only or not _entries.contains(path)) and seen.insert(path).second) {
+            pending.push_back(path.c_str());
+        }
+    }
+
+    std::vector<file_metadata> metadata(pending.size());
+    query_all(pending, metadata, _threads);
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        _entries[pending[i]] = metadata[i];
+    }
+    return pending.size();
+}
+
+std::size_t metadata_cache::fetch(const std::vector<std::string>& paths) {
+    return store(paths, true);
+}
+
+std::size_t metadata_cache::refresh(const std::vector<std::string>& paths) {
+    return store(paths, false);
+}
+
+const file_metadata& metadata_cache::get(path_ref path) {
+    if (const auto it = _entries.find(path); it != _entries.end()) {
+        return it->second;
+    }
+
+    // Interned keys are NUL-terminated, the new entry's key can be queried directly.
+    auto& [key, metadata] = *_entries.try_emplace(path).first;
+    metadata = query(key.data());
+    return metadata;
+}
+
+const file_metadata* metadata_cache::find(path_ref path) const {
+    const auto it = _entries.find(path);
+    return (it == _entries.cend()) ? nullptr : &it->second;
+}
+
+bool metadata_cache::invalidate(path_ref path) {
+    return _entries.erase(path) > 0;
+}
+
+void metadata_cache::invalidate() {
+    _entries.clear();
+}
+
+std::size_t metadata_cache::size() const noexcept {
+    return _entries.size();
+}
@@ -0,0 +1,175 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::max, std::min
+#include <cerrno>       // errno
+#include <cstring>      // std::memchr, std::memmove
+#include <iostream>     // std::cerr
+#include <memory>       // std::unique_ptr
+
+// POSIX
+#include <fcntl.h>      // open, posix_fadvise
+#include <unistd.h>     // read
+
+// SIMD
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // SSE2, AVX2 intrinsics
+#define FABER_RECORDS_X86 1
+#endif
+
+// internal
+#include <records.h>
+#include "unique_fd.h"
+
+namespace impl_details = faber::io::impl_details;
+
+using unique_fd = impl_details::unique_fd;
+
+/********** records.cpp **********/
+
+/********** Delimiter Search **********/
+
+namespace {
+
+    const char* find_scalar(const char* first, const char* last, char delimiter) noexcept {
+        const auto* p = static_cast<const char*>(std::memchr(first, delimiter, static_cast<std::size_t>(last - first)));
+        return p ? p : last;
+    }
+
+#ifdef FABER_RECORDS_X86
+
+    __attribute__((target("sse2")))
+    const char* find_sse2(const char* first, const char* last, char delimiter) noexcept {
+        const __m128i needle = _mm_set1_epi8(delimiter);
+        for (; last - first >= 16; first += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+            if (const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)); mask != 0) {
+                return first + __builtin_ctz(static_cast<unsigned>(mask));
+            }
+        }
+        for (; first != last; ++first) {
+            if (*first == delimiter) { return first; }
+        }
+        return last;
+    }
+
+    __attribute__((target("avx2")))
+    const char* find_avx2(const char* first, const char* last, char delimiter) noexcept {
+        const __m256i needle = _mm256_set1_epi8(delimiter);
+        for (; last - first >= 32; first += 32) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            if (const int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)); mask != 0) {
+                return first + __builtin_ctz(static_cast<unsigned>(mask));
+            }
+        }
+        return find_sse2(first, last, delimiter); // tail, less than 32 bytes
+    }
+
+#endif // FABER_RECORDS_X86
+
+    using find_fn = const char* (*)(const char*, const char*, char) noexcept;
+
+    /** Picks the widest implementation supported by the running CPU, once. */
+    find_fn select_find() noexcept {
+#ifdef FABER_RECORDS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) { return find_avx2; }
+        if (__builtin_cpu_supports("sse2")) { return find_sse2; }
+#endif
+        return find_scalar;
+    }
+
+    const find_fn find_impl = select_find();
+
+    ssize_t read_some(int fd, char* dst, std::size_t capacity) {
+        for (;;) {
+            const ssize_t n = ::read(fd, dst, capacity);
+            if (n == -1 and errno == EINTR) { continue; }
+            return n;
+        }
+    }
+
+} // namespace
+
+/********** impl_details **********/
+
+const char* impl_details::find_delimiter(const char* first, const char* last, char delimiter) noexcept {
+    return find_impl(first, last, delimiter);
+}
+
+bool impl_details::scan_records(const std::string& filename, char delimiter, std::size_t block_size, record_sink sink, void* context) {
+    // Closed however the scan ends, `sink` may throw.
+    const unique_fd fd{::open(filename.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (not fd) {
+        std::cerr << "[ERROR] Failed to open file `" << filename << "`\n";
+        return false;
+    }
+    ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    block_size = (block_size > 0) ? block_size : 1;
+    std::size_t capacity = block_size;
+    auto buffer = std::make_unique<char[]>(capacity);
+
+    // `[0, carry)` holds the beginning of a record that crossed the previous block boundary.
+    std::size_t carry = 0;
+    for (;;) {
+        if (carry > capacity / 2) {
+            // A single record filling most of the buffer, grow it so reads stay large.
+            auto grown = std::make_unique<char[]>(capacity * 2);
+            std::memcpy(grown.get(), buffer.get(), carry);
+            buffer = std::move(grown);
+            capacity *= 2;
+        }
+
+        const ssize_t n = read_some(fd.get(), buffer.get() + carry, capacity - carry);
+        if (n == -1) {
+            std::cerr << "[ERROR] Failed to read file `" << filename << "`\n";
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        const char* first = buffer.get();
+        const char* last  = buffer.get() + carry + n;
+        // Delimiters can't be in the carried part, it was already scanned.
+        const char* cursor = buffer.get() + carry;
+        for (const char* d; (d = find_impl(cursor, last, delimiter)) != last; cursor = first = d + 1) {
+            if (not sink(context, std::string_view{first, static_cast<std::size_t>(d - first)})) {
+                return false;
+            }
+        }
+
+        carry = static_cast<std::size_t>(last - first);
+        std::memmove(buffer.get(), first, carry);
+    }
+
+    // Trailing record with no delimiter after it.
+    if (carry > 0) {
+        return sink(context, std::string_view{buffer.get(), carry});
+    }
+    return true;
+}
+
+/********** Parallel Processing **********/
+
+std::vector<std::string_view> impl_details::split_records(std::string_view data, std::size_t chunk_size, char delimiter) {
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+
+    std::vector<std::string_view> ranges{};
+    ranges.reserve(data.size() / chunk_size + 1);
+
+    const char* const last = data.data() + data.size();
+    const char* first = data.data();
+    while (static_cast<std::size_t>(last - first) > chunk_size) {
+        // Only the bytes past the nominal boundary are scanned.
+        const char* end = find_delimiter(first + chunk_size - 1, last, delimiter);
+        end = (end == last) ? last : end + 1;
+        ranges.emplace_back(first, static_cast<std::size_t>(end - first));
+        first = end;
+    }
+    if (first != last or ranges.empty()) {
+        ranges.emplace_back(first, static_cast<std::size_t>(last - first));
+    }
+    return ranges;
+}
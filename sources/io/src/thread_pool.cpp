@@ -0,0 +1,113 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>    // std::max, std::min
+#include <atomic>       // std::atomic
+#include <exception>    // std::exception_ptr, std::rethrow_exception
+#include <utility>      // std::move
+
+// internal
+#include <thread_pool.h>
+
+namespace impl_details = faber::io::impl_details;
+
+using thread_pool = faber::io::thread_pool;
+
+/********** thread_pool.cpp **********/
+
+/********** Constructors & Destructor **********/
+
+thread_pool::thread_pool(std::size_t threads) {
+    threads = std::max<std::size_t>(threads, 1);
+    _workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        _workers.emplace_back([this](std::stop_token stop) { worker_loop(stop); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    for (auto& worker : _workers) {
+        worker.request_stop();
+    }
+    _cv.notify_all();
+    _workers.clear(); // joins
+}
+
+/********** Private Member Functions **********/
+
+void thread_pool::worker_loop(std::stop_token stop) {
+    for (;;) {
+        std::function<void()> task{};
+        {
+            std::unique_lock lock{_mutex};
+            _cv.wait(lock, stop, [this] { return not _tasks.empty(); });
+
+            // Woken up by a stop request, only leave once the queue is drained.
+            if (_tasks.empty()) {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
+
+/********** Public Member Functions **********/
+
+void thread_pool::post(std::function<void()> task) {
+    {
+        std::lock_guard lock{_mutex};
+        _tasks.push_back(std::move(task));
+    }
+    _cv.notify_one();
+}
+
+std::size_t thread_pool::size() const noexcept {
+    return _workers.size();
+}
+
+/********** Implementation Details **********/
+
+bool impl_details::run_chunks(std::size_t count, std::size_t threads, chunk_task task, void* context) {
+    if (threads == 0) {
+        threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    threads = std::max<std::size_t>(std::min(threads, count), 1);
+
+    std::atomic<std::size_t>    next{0};
+    std::atomic<bool>           stopped{false};
+    std::atomic<bool>           completed{true};
+    std::mutex                  error_mutex{};
+    std::exception_ptr          error{};
+
+    const auto work = [&] {
+        for (auto i = next.fetch_add(1); i < count and not stopped.load(std::memory_order_relaxed); i = next.fetch_add(1)) {
+            try {
+                if (not task(context, i)) {
+                    completed.store(false, std::memory_order_relaxed);
+                    stopped.store(true, std::memory_order_relaxed);
+                }
+            } catch (...) {
+                std::lock_guard lock{error_mutex};
+                if (not error) {
+                    error = std::current_exception();
+                }
+                stopped.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+    {
+        std::vector<std::jthread> workers{};
+        workers.reserve(threads - 1);
+        for (std::size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(work);
+        }
+        work(); // the calling thread processes chunks too
+    } // joins
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return completed.load();
+}
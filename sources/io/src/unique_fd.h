@@ -0,0 +1,69 @@
+#ifndef FABER_UNIQUE_FD_H
+#define FABER_UNIQUE_FD_H
+
+/********** Headers **********/
+
+// C++ stdlib
+#include <utility>  // std::exchange
+
+// POSIX
+#include <unistd.h> // close
+
+/********** unique_fd.h **********/
+
+namespace faber { inline namespace v1_0_0 {
+
+    namespace io {
+
+        /** Implementation details, internal to the library. */
+        namespace impl_details {
+
+            /** Owns a file descriptor, closed when the object goes out of scope. */
+            class unique_fd {
+            public:
+                /********** Constructors & Destructor **********/
+
+                unique_fd() noexcept = default;
+                explicit unique_fd(int fd) noexcept : _fd(fd) { }
+
+                unique_fd(const unique_fd&) = delete; // copy constructor (deleted)
+                unique_fd(unique_fd&& other) noexcept : _fd(std::exchange(other._fd, -1)) { }
+
+                ~unique_fd() { reset(); }
+
+            public:
+                /********** Public Member Functions **********/
+
+                int get() const noexcept { return _fd; }
+                explicit operator bool() const noexcept { return _fd != -1; }
+
+                /** Gives up ownership without closing, for callers that check `close` themselves. */
+                int release() noexcept { return std::exchange(_fd, -1); }
+
+                /** Closes the current descriptor (if any) and takes ownership of `fd`. */
+                void reset(int fd = -1) noexcept {
+                    if (const int old = std::exchange(_fd, fd); old != -1) {
+                        ::close(old);
+                    }
+                }
+
+                unique_fd& operator=(const unique_fd&) = delete; // copy assignment (deleted)
+                unique_fd& operator=(unique_fd&& other) noexcept {
+                    reset(std::exchange(other._fd, -1));
+                    return *this;
+                }
+
+            private:
+                /********** Private Members **********/
+
+                int _fd{-1};
+            }; // class unique_fd
+
+        } // namespace impl_details
+
+    } // namespace io
+
+} // inline namespace v1_0_0
+} // namespace faber
+
+#endif // FABER_UNIQUE_FD_H
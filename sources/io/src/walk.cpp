@@ -0,0 +1,295 @@
+/********** Headers **********/
+
+// C++ stdlib
+#include <algorithm>            // std::max
+#include <atomic>               // std::atomic
+#include <condition_variable>   // std::condition_variable
+#include <cstring>              // std::strcmp
+#include <deque>                // std::deque
+#include <exception>            // std::exception_ptr
+#include <iostream>             // std::cerr
+#include <memory>               // std::unique_ptr
+#include <mutex>                // std::mutex
+#include <optional>             // std::optional
+#include <string>               // std::string
+#include <thread>               // std::thread::hardware_concurrency
+#include <utility>              // std::pair
+#include <vector>               // std::vector
+
+// POSIX
+#include <dirent.h>             // struct dirent64, DT_*
+#include <fcntl.h>              // open, O_DIRECTORY
+#include <sys/stat.h>           // fstatat
+#include <sys/syscall.h>        // SYS_getdents64
+#include <unistd.h>             // syscall
+
+// internal
+#include <thread_pool.h>
+#include <walk.h>
+#include "unique_fd.h"
+
+namespace io = faber::io;
+namespace impl_details = faber::io::impl_details;
+
+/********** walk.cpp **********/
+
+/********** Internal Helpers **********/
+
+namespace {
+
+    /** A directory waiting to be listed. */
+    using pending_dir = std::pair<std::string, std::size_t>; // path, depth of its entries
+
+    constexpr std::size_t dirent_buffer_size = 64 * 1024;
+
+    io::entry_type from_d_type(unsigned char d_type) noexcept {
+        switch (d_type) {
+            case DT_REG:  return io::entry_type::regular;
+            case DT_DIR:  return io::entry_type::directory;
+            case DT_LNK:  return io::entry_type::symlink;
+            case DT_BLK:  return io::entry_type::block;
+            case DT_CHR:  return io::entry_type::character;
+            case DT_FIFO: return io::entry_type::fifo;
+            case DT_SOCK: return io::entry_type::socket;
+            default:      return io::entry_type::unknown;
+        }
+    }
+
+    io::entry_type from_st_mode(mode_t mode) noexcept {
+        if (S_ISREG(mode))  { return io::entry_type::regular; }
+        if (S_ISDIR(mode))  { return io::entry_type::directory; }
+        if (S_ISLNK(mode))  { return io::entry_type::symlink; }
+        if (S_ISBLK(mode))  { return io::entry_type::block; }
+        if (S_ISCHR(mode))  { return io::entry_type::character; }
+        if (S_ISFIFO(mode)) { return io::entry_type::fifo; }
+        if (S_ISSOCK(mode)) { return io::entry_type::socket; }
+        return io::entry_type::unknown;
+    }
+
+    /**
+     * Lists a single directory with `getdents64`, invoking `on_entry` for each entry
+     * except `.` and `..`. Only entries whose type the filesystem doesn't report are
+     * `stat`ed.
+     *
+     * @returns `false` if the directory could not be opened.
+    */
+    template<typename OnEntry>
+    bool list_directory(const std::string& dir, std::size_t depth, OnEntry&& on_entry) {
+        // Closed even if `on_entry` throws.
+        const impl_details::unique_fd dir_fd{::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (not dir_fd) {
+            return false;
+        }
+        const int fd = dir_fd.get();
+
+        // Reused for every entry, only the name part changes.
+        std::string path{dir};
+        if (path.empty() or path.back() != '/') {
+            path += '/';
+        }
+        const auto base = path.size();
+
+        alignas(dirent64) char buffer[dirent_buffer_size];
+        for (;;) {
+            const auto n = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                break;
+            }
+
+            for (long offset = 0; offset < n; ) {
+                const auto* d = reinterpret_cast<const dirent64*>(buffer + offset);
+                offset += d->d_reclen;
+
+                if (std::strcmp(d->d_name, ".") == 0 or std::strcmp(d->d_name, "..") == 0) {
+                    continue;
+                }
+
+                path.resize(base);
+                path.append(d->d_name);
+
+                auto type = from_d_type(d->d_type);
+                if (type == io::entry_type::unknown) {
+                    if (struct stat st{}; ::fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                        type = from_st_mode(st.st_mode);
+                    }
+                }
+
+                const std::string_view view{path};
+                on_entry(io::dir_entry{ view, view.substr(base), type, d->d_ino, depth });
+            }
+        }
+        return true;
+    }
+
+    /** A worker's queue of directories, padded to its own cache line. */
+    struct alignas(64) work_queue {
+        std::mutex              mutex{};
+        std::deque<pending_dir> dirs{};
+    };
+
+    /** State shared by all workers of a `parallel_walk`. */
+    class walker {
+    public:
+        walker(std::size_t workers, const io::walk_callback& callback, const io::walk_filter& filter)
+            : _queues(workers), _callback(callback), _filter(filter) { }
+
+        void push(std::size_t worker, pending_dir dir) {
+            _pending.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard lock{_queues[worker].mutex};
+                _queues[worker].dirs.push_back(std::move(dir));
+            }
+            _queued.fetch_add(1, std::memory_order_release);
+            {
+                // Taken so a worker can't miss the wakeup between checking and sleeping.
+                std::lock_guard lock{_idle_mutex};
+            }
+            _idle_cv.notify_one();
+        }
+
+        void run(std::size_t worker) {
+            for (;;) {
+                if (auto dir = take(worker)) {
+                    _queued.fetch_sub(1, std::memory_order_relaxed);
+                    process(worker, *dir);
+                    if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        std::lock_guard lock{_idle_mutex};
+                        _idle_cv.notify_all();
+                    }
+                    continue;
+                }
+
+                std::unique_lock lock{_idle_mutex};
+                _idle_cv.wait(lock, [this] {
+                    return _queued.load(std::memory_order_acquire) > 0 or _pending.load(std::memory_order_acquire) == 0;
+                });
+                if (_pending.load(std::memory_order_acquire) == 0) {
+                    return;
+                }
+            }
+        }
+
+        void rethrow_if_failed() {
+            if (_error) {
+                std::rethrow_exception(_error);
+            }
+        }
+
+    private:
+        /** LIFO from the worker's own queue, FIFO from the others' (stealing). */
+        std::optional<pending_dir> take(std::size_t worker) {
+            {
+                auto& own = _queues[worker];
+                std::lock_guard lock{own.mutex};
+                if (not own.dirs.empty()) {
+                    auto dir = std::move(own.dirs.back());
+                    own.dirs.pop_back();
+                    return dir;
+                }
+            }
+            for (std::size_t i = 1; i < _queues.size(); ++i) {
+                auto& victim = _queues[(worker + i) % _queues.size()];
+                std::lock_guard lock{victim.mutex};
+                if (not victim.dirs.empty()) {
+                    auto dir = std::move(victim.dirs.front());
+                    victim.dirs.pop_front();
+                    return dir;
+                }
+            }
+            return std::nullopt;
+        }
+
+        void process(std::size_t worker, const pending_dir& dir) {
+            if (_stopped.load(std::memory_order_relaxed)) {
+                return;
+            }
+            try {
+                list_directory(dir.first, dir.second, [&](const io::dir_entry& entry) {
+                    if (_filter and not _filter(entry)) {
+                        return;
+                    }
+                    _callback(entry);
+                    if (entry.type == io::entry_type::directory) {
+                        push(worker, pending_dir{ std::string{entry.path}, entry.depth + 1 });
+                    }
+                });
+            } catch (...) {
+                std::lock_guard lock{_error_mutex};
+                if (not _error) {
+                    _error = std::current_exception();
+                }
+                _stopped.store(true, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        std::vector<work_queue>     _queues;
+        const io::walk_callback&    _callback;
+        const io::walk_filter&      _filter;
+
+        std::atomic<std::size_t>    _pending{0}; // queued or being listed
+        std::atomic<std::size_t>    _queued{0};  // queued only
+        std::mutex                  _idle_mutex{};
+        std::condition_variable     _idle_cv{};
+
+        std::atomic<bool>           _stopped{false};
+        std::mutex                  _error_mutex{};
+        std::exception_ptr          _error{};
+    };
+
+    bool is_directory(const std::string& path) {
+        struct stat st{};
+        return ::stat(path.c_str(), &st) == 0 and S_ISDIR(st.st_mode);
+    }
+
+} // namespace
+
+/********** API **********/
+
+bool io::walk(const std::filesystem::path& root, const walk_callback& callback, const walk_filter& filter) {
+    if (not is_directory(root.native())) {
+        std::cerr << "[ERROR] Failed to open directory `" << root.native() << "`\n";
+        return false;
+    }
+
+    std::vector<pending_dir> stack{ pending_dir{ root.native(), 0 } };
+    while (not stack.empty()) {
+        const auto dir = std::move(stack.back());
+        stack.pop_back();
+
+        list_directory(dir.first, dir.second, [&](const dir_entry& entry) {
+            if (filter and not filter(entry)) {
+                return;
+            }
+            callback(entry);
+            if (entry.type == entry_type::directory) {
+                stack.emplace_back(std::string{entry.path}, entry.depth + 1);
+            }
+        });
+    }
+    return true;
+}
+
+bool io::parallel_walk(const std::filesystem::path& root, const walk_callback& callback, const walk_filter& filter, std::size_t threads) {
+    if (not is_directory(root.native())) {
+        std::cerr << "[ERROR] Failed to open directory `" << root.native() << "`\n";
+        return false;
+    }
+
+    if (threads == 0) {
+        threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    }
+
+    walker state{threads, callback, filter};
+    state.push(0, pending_dir{ root.native(), 0 });
+
+    // One chunk per worker, the index being the worker's queue.
+    const impl_details::chunk_task task = [](void* ctx, std::size_t worker) -> bool {
+        static_cast<walker*>(ctx)->run(worker);
+        return true;
+    };
+    impl_details::run_chunks(threads, threads, task, &state);
+
+    state.rethrow_if_failed();
+    return true;
+}
@@ -1,22 +1,1381 @@
+#include <async.h>
+#include <batch_io.h>
+#include <commit_group.h>
+#include <concurrent_file_monitor.h>
 #include <file_monitor.h>
+#include <file_watcher.h>
+#include <flat_table.h>
+#include <io.h>
+#include <records.h>
+#include <walk.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory_resource>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
-int main() {
-    using namespace faber;
-    using namespace std::string_literals;
-    using namespace std::string_view_literals;
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    int failures = 0;
+
+    /** Reports a failed expectation and keeps going, `main` returns non-zero if any failed. */
+    void check(bool condition, const char* expression, const char* file, int line) {
+        if (not condition) {
+            std::cerr << "[FAIL] " << file << ':' << line << ": " << expression << '\n';
+            ++failures;
+        }
+    }
+
+    #define CHECK(...) check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+
+    /** `true` if invoking `fn` throws an exception of type `E`. */
+    template<typename E>
+    bool throws(const std::function<void()>& fn) {
+        try {
+            fn();
+        } catch (const E&) {
+            return true;
+        } catch (...) {
+            return false;
+        }
+        return false;
+    }
+
+    void write_text(const fs::path& path, const std::string& text) {
+        if (path.has_parent_path()) {
+            fs::create_directories(path.parent_path());
+        }
+        std::ofstream{path, std::ios::binary | std::ios::trunc} << text;
+    }
+
+    std::string read_text(const fs::path& path) {
+        std::ifstream file{path, std::ios::binary};
+        return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+
+    /** Number of entries of `directory` whose name starts with `prefix`. */
+    std::size_t count_prefixed(const fs::path& directory, const std::string& prefix) {
+        return static_cast<std::size_t>(std::ranges::count_if(fs::directory_iterator{directory}, [&](const auto& entry) {
+            return entry.path().filename().string().starts_with(prefix);
+        }));
+    }
+
+    /** Number of descriptors open in the process. */
+    std::size_t open_descriptors() {
+        return static_cast<std::size_t>(std::distance(fs::directory_iterator{"/proc/self/fd"}, fs::directory_iterator{}));
+    }
+
+    /********** read_all & filesize **********/
+
+    void test_read_all() {
+        using namespace faber;
+
+        const std::string contents = "line one\nline two\n" + std::string(10'000, 'z');
+        write_text("read/all.txt", contents);
+        write_text("read/empty.txt", "");
+
+        std::string text = "previous contents, replaced";
+        CHECK(io::read_all("read/all.txt", text) and text == contents);
+        CHECK(io::read_all("read/empty.txt", text) and text.empty());
+
+        std::vector<std::byte> bytes{};
+        CHECK(io::read_all("read/all.txt", bytes) and bytes.size() == contents.size());
+        CHECK(bytes.size() == contents.size() and std::equal(contents.begin(), contents.end(), bytes.begin(),
+            [](char c, std::byte b) { return static_cast<std::byte>(c) == b; }));
+
+        CHECK(not io::read_all("read/missing.txt", text));
+
+        std::vector<std::byte> buffer(contents.size());
+        std::size_t read = 0;
+        CHECK(io::read_into("read/all.txt", buffer, read) and read == contents.size());
+        CHECK(not io::read_into("read/all.txt", std::span{buffer}.first(10), read)); // too small
+    }
+
+    void test_filesize() {
+        using namespace faber;
+
+        write_text("size.txt", "0123456789");
+        CHECK(io::filesize(std::string{"size.txt"}) == 10);
+        CHECK(io::filesize(std::string{"missing.txt"}) == 0);
+
+        std::fstream file{"size.txt", std::fstream::in | std::fstream::out};
+        char first = 0;
+        file.get(first);
+        CHECK(io::filesize(file) == 10);
+        CHECK(file.tellg() == 1); // position kept
+
+        // Buffered output counts.
+        file.seekp(0, std::fstream::end);
+        file << "abcdef";
+        CHECK(io::filesize(file) == 16);
+    }
+
+    /********** flat_table **********/
+
+    void test_flat_table_erase_and_rehash() {
+        using namespace faber;
+
+        /** Neither copyable nor movable, values must be constructed in place and never moved. */
+        struct pinned {
+            explicit pinned(int v) : value(v) { if (v < 0) { throw std::invalid_argument{"negative"}; } }
+            pinned(const pinned&) = delete;
+            pinned& operator=(const pinned&) = delete;
+            int value;
+        };
+
+        io::flat_table<pinned> table{};
+        constexpr int count = 5000;
+        for (int i = 0; i < count; ++i) {
+            // Keys built in temporaries, the table must own copies of them.
+            const auto [it, inserted] = table.try_emplace("dir/" + std::to_string(i), i);
+            CHECK(inserted and it->second.value == i);
+        }
+        CHECK(table.size() == count);
+        CHECK(not table.try_emplace(std::string{"dir/42"}, -1).second);
+
+        // References survive erasures and the rehashes of later insertions.
+        const pinned* const tracked = &table.at("dir/4998");
+
+        // Erase two thirds, backward shifting through every cluster.
+        for (int i = 0; i < count; ++i) {
+            if (i % 3 != 0) {
+                CHECK(table.erase("dir/" + std::to_string(i)) == 1);
+            }
+        }
+        CHECK(table.size() == (count + 2) / 3);
+        CHECK(table.erase(std::string{"dir/1"}) == 0);
+
+        bool lookups_ok = true;
+        for (int i = 0; i < count; ++i) {
+            const auto it = table.find("dir/" + std::to_string(i));
+            lookups_ok = lookups_ok and ((i % 3 == 0) ? (it != table.end() and it->second.value == i) : it == table.end());
+        }
+        CHECK(lookups_ok);
+
+        // Reinsertion reuses the erased nodes and grows past the original size.
+        for (int i = count; i < 2 * count; ++i) {
+            table.try_emplace("dir/" + std::to_string(i), i);
+        }
+        CHECK(table.size() == (count + 2) / 3 + count);
+        CHECK(table.at("dir/3").value == 3 and table.at("dir/9999").value == 9999);
+        CHECK(tracked == &table.at("dir/4998") and tracked->value == 4998);
+        CHECK(std::distance(table.begin(), table.end()) == static_cast<std::ptrdiff_t>(table.size()));
+        CHECK(throws<std::out_of_range>([&] { table.at("dir/2"); }));
+
+        // A throwing constructor leaves neither the key nor the node behind.
+        const auto before = table.size();
+        CHECK(throws<std::invalid_argument>([&] { table.try_emplace("dir/bad", -1); }));
+        CHECK(not table.contains("dir/bad") and table.size() == before);
+        CHECK(table.try_emplace("dir/good", 1).second and table.at("dir/good").value == 1);
+
+        table.clear();
+        CHECK(table.empty() and table.begin() == table.end() and not table.contains("dir/0"));
+        table.try_emplace("dir/0", 7);
+        CHECK(table.at(fs::path{"dir/0"}).value == 7);
+    }
+
+    void test_path_arena_reuses_blocks() {
+        using namespace faber;
+
+        io::path_arena arena{};
+        const std::string path(100, 'p');
+
+        std::vector<io::path_arena::interned> paths{};
+        for (int i = 0; i < 1000; ++i) {
+            paths.push_back(arena.intern(path));
+        }
+        CHECK(std::ranges::all_of(paths, [&](const auto& p) { return p.view == path and p.view.data()[p.view.size()] == '\0'; }));
+        const auto peak = arena.capacity();
+
+        // Open/close churn stays within the memory already reserved.
+        for (int round = 0; round < 5; ++round) {
+            for (const auto& p : paths) {
+                arena.release(p);
+            }
+            paths.clear();
+            for (int i = 0; i < 1000; ++i) {
+                paths.push_back(arena.intern(path));
+            }
+        }
+        CHECK(arena.capacity() == peak);
+
+        // Larger than a block.
+        const std::string huge(io::path_arena::block_size * 2, 'h');
+        const auto big = arena.intern(huge);
+        CHECK(big.view == huge);
+        arena.release(big);
+    }
+
+    /********** file_monitor **********/
+
+    void test_file_monitor_smoke() {
+        using namespace faber;
+        using namespace std::string_literals;
+        using namespace std::string_view_literals;
+
+        write_text("path/to/file1", "");
+        write_text("path/to/file2", "0123456789abcdef");
+
+        io::file_monitor opened_files {
+            { "path/to/file1", std::fstream::in                       },
+            { "path/to/file2", (std::fstream::in | std::fstream::out) }
+        };
+
+        constexpr size_t BUF_SIZE{15};
+        const auto buf = std::make_unique<char[]>(BUF_SIZE + 1);
+        if (const auto& [stream, mode, size] = opened_files["path/to/file2"sv];
+            size >= BUF_SIZE && mode == (std::fstream::in | std::fstream::out))
+        {
+            stream->read(buf.get(), BUF_SIZE);
+            buf[BUF_SIZE] = '\0';
+        }
+        CHECK(std::string{buf.get()} == "0123456789abcde");
+    }
+
+    void test_file_monitor_mapped_only() {
+        using namespace faber;
+
+        write_text("mapped.txt", "mapped contents");
+
+        io::file_monitor monitor{};
+        const auto& mapping = monitor.open_mapped("mapped.txt");
+        CHECK(mapping.size() == 15);
+
+        // No stream to hand out: both lookups throw instead of exposing a null stream.
+        CHECK(throws<std::runtime_error>([&] { monitor["mapped.txt"]; }));
+        CHECK(throws<std::runtime_error>([&] { std::as_const(monitor)["mapped.txt"]; }));
+        CHECK(throws<std::out_of_range>([&] { monitor["missing.txt"]; }));
+        CHECK(monitor.find("missing.txt") == monitor.data().cend());
+        CHECK(monitor.find("mapped.txt")->second.mapping.is_open());
+
+        // Opening it afterwards attaches a stream to the same entry, mapping included.
+        auto& stream = monitor.open("mapped.txt", std::fstream::in);
+        std::string word{};
+        CHECK(stream >> word and word == "mapped");
+        CHECK(monitor["mapped.txt"].stream.get() == &stream);
+        CHECK(&monitor.find("mapped.txt")->second.mapping == &mapping and mapping.is_open());
+        CHECK(monitor.open_streams() == 1);
+        CHECK(throws<std::runtime_error>([&] { monitor.open("mapped.txt", std::fstream::in); }));
+    }
+
+    void test_read_file_mapped() {
+        using namespace faber;
+
+        write_text("mapped_read.txt", "one\ntwo\nthree\n");
+        write_text("mapped_empty.txt", "");
+
+        std::size_t lines = 0;
+        CHECK(io::read_file("mapped_read.txt", [&lines](std::span<const std::byte> bytes) {
+            lines = static_cast<std::size_t>(std::ranges::count(bytes, std::byte{'\n'}));
+            return true;
+        }));
+        CHECK(lines == 3);
+
+        bool empty = false;
+        CHECK(io::read_file("mapped_empty.txt", [&empty](std::span<const std::byte> bytes) {
+            empty = bytes.empty();
+            return true;
+        }));
+        CHECK(empty);
+
+        CHECK(not io::read_file("mapped_missing.txt", [](std::span<const std::byte>) { return true; }));
+
+        // Mapping next to an existing stream reuses the entry.
+        io::file_monitor monitor{};
+        monitor.open("mapped_read.txt", std::fstream::in);
+        const auto& mapping = monitor.open_mapped("mapped_read.txt");
+        CHECK(mapping.size() == 14 and monitor.data().size() == 1);
+        CHECK(&monitor.open_mapped("mapped_read.txt") == &mapping);
+        CHECK(monitor["mapped_read.txt"].stream->is_open());
+    }
+
+    /** Forwards to the default resource, counting the blocks currently allocated. */
+    class counting_resource final : public std::pmr::memory_resource {
+    public:
+        std::size_t live = 0;
 
-    io::file_monitor opened_files {
-        { "path/to/file1", std::fstream::in                       },
-        { "path/to/file2", (std::fstream::in | std::fstream::out) }
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++live;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            --live;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
     };
 
-    constexpr size_t BUF_SIZE{15};
-    const auto buf = std::make_unique<char[]>(BUF_SIZE + 1);
-    if (const auto& [stream, mode, size] = opened_files["path/to/file2"sv]; 
-        size >= BUF_SIZE && mode == (std::fstream::in | std::fstream::out))
-    {
-        stream->read(buf.get(), BUF_SIZE);
-        buf[BUF_SIZE] = '\0';
+    void test_file_monitor_resource() {
+        using namespace faber;
+
+        write_text("resource/a.txt", "a");
+        counting_resource resource{};
+        {
+            io::file_monitor monitor{&resource};
+            monitor.open("resource/a.txt", std::fstream::in);
+
+            // The stream object itself comes from the resource, not only its buffer.
+            CHECK(monitor["resource/a.txt"].stream.get_deleter().resource == &resource);
+            CHECK(resource.live > 0);
+            monitor.close("resource/a.txt");
+        }
+        CHECK(resource.live == 0);
+    }
+
+    void test_file_monitor_lru() {
+        using namespace faber;
+
+        write_text("lru/a", "abcdef");
+        write_text("lru/b", "ghijkl");
+        write_text("lru/c", "mnopqr");
+
+        io::file_monitor monitor{};
+        monitor.set_capacity(2);
+        auto& a = monitor.open("lru/a", std::fstream::in);
+        auto& b = monitor.open("lru/b", std::fstream::in);
+
+        char ch{};
+        a.get(ch);
+        CHECK(ch == 'a');
+
+        // `a` is the least recently used one and is evicted, its position saved.
+        monitor.open("lru/c", std::fstream::in);
+        CHECK(monitor.open_streams() == 2);
+        CHECK(not a.is_open());
+        CHECK(b.is_open());
+
+        // Reopened transparently where it left off, evicting `b` in turn.
+        auto& [stream, mode, size] = monitor["lru/a"];
+        CHECK(stream->get(ch) and ch == 'b');
+        CHECK(monitor.open_streams() == 2);
+        CHECK(not b.is_open());
+        CHECK(size == 6 and mode == std::fstream::in);
+
+        // Closed by hand: reopened from the start, without being counted twice.
+        a.close();
+        CHECK(monitor["lru/a"].stream->is_open());
+        CHECK(a.get(ch) and ch == 'a');
+        CHECK(monitor.open_streams() == 2);
+
+        // Cache hits and evictions keep working on a consistent list.
+        CHECK(&monitor.open("lru/b", std::fstream::in) == &b);
+        CHECK(monitor.open_streams() == 2);
+        CHECK(b.is_open() and a.is_open());
+        monitor.close("lru/a");
+        monitor.close("lru/b");
+        CHECK(monitor.open_streams() == 0);
+
+        // Without a capacity streams are only counted, and ranked again once enabled.
+        monitor.set_capacity(0);
+        write_text("lru/d", "stuvwx");
+        monitor.open("lru/d", std::fstream::in);
+        CHECK(monitor["lru/c"].stream->is_open());
+        CHECK(monitor.open_streams() == 2);
+
+        // Streams closed by hand are only reopened by the cache.
+        monitor["lru/d"].stream->close();
+        CHECK(not monitor["lru/d"].stream->is_open());
+        monitor["lru/d"].stream->open("lru/d", std::fstream::in);
+        monitor.set_capacity(1);
+        CHECK(monitor.open_streams() == 1);
+        monitor.close("lru/c");
+        monitor.close("lru/d");
+        CHECK(monitor.open_streams() == 0);
+    }
+
+    void test_file_monitor_records_hints() {
+        using namespace faber;
+
+        write_text("hints/mapped.txt", "mapped");
+        write_text("hints/stream.txt", "stream");
+
+        io::file_monitor monitor{};
+        const auto hint_of = [&](const char* path) { return monitor.find(path)->second.hint; };
+
+        // Mapping-only entry.
+        monitor.open_mapped("hints/mapped.txt", io::access_hint::random);
+        CHECK(hint_of("hints/mapped.txt") == io::access_hint::random);
+
+        // Cache hit with a new hint.
+        monitor.set_capacity(4);
+        monitor.open("hints/stream.txt", std::fstream::in, io::access_hint::sequential);
+        CHECK(hint_of("hints/stream.txt") == io::access_hint::sequential);
+        monitor.open("hints/stream.txt", std::fstream::in, io::access_hint::random);
+        CHECK(hint_of("hints/stream.txt") == io::access_hint::random);
+        monitor.open("hints/stream.txt", std::fstream::in);
+        CHECK(hint_of("hints/stream.txt") == io::access_hint::random);
+
+        // Stream and mapping of the same entry.
+        monitor.open_mapped("hints/stream.txt", io::access_hint::willneed);
+        CHECK(hint_of("hints/stream.txt") == io::access_hint::willneed);
+        CHECK(monitor.advise("hints/stream.txt", io::access_hint::dontneed));
+        CHECK(hint_of("hints/stream.txt") == io::access_hint::dontneed);
+    }
+
+    void test_file_monitor_warm() {
+        using namespace faber;
+
+        std::vector<std::string> paths{};
+        for (int i = 0; i < 12; ++i) {
+            paths.push_back("warm/" + std::to_string(i) + ".txt");
+            write_text(paths.back(), std::to_string(i));
+        }
+
+        io::file_monitor monitor{};
+        monitor.open(paths.front().c_str(), std::fstream::in);
+        CHECK(monitor.warm(paths, std::fstream::in, io::access_hint::sequential, 3) == paths.size() - 1); // first one skipped
+        CHECK(monitor.data().size() == paths.size());
+        CHECK(monitor.find(paths.back())->second.hint == io::access_hint::sequential);
+        CHECK(monitor.find(paths.front())->second.hint == io::access_hint::normal);
+
+        std::string value{};
+        *monitor[paths[7]].stream >> value;
+        CHECK(value == "7");
+
+        // A missing file stops the warm-up, the files before it stay registered.
+        write_text("warm/new.txt", "");
+        CHECK(throws<std::runtime_error>([&] {
+            monitor.warm({ "warm/new.txt", "warm/missing.txt", "warm/never.txt" }, std::fstream::in);
+        }));
+        CHECK(monitor.find("warm/new.txt") != monitor.data().cend());
+        CHECK(monitor.find("warm/missing.txt") == monitor.data().cend());
+    }
+
+    void test_file_monitor_stats() {
+        using namespace faber;
+        using namespace std::chrono_literals;
+
+        write_text("stats/before.txt", "0123456789");
+        write_text("stats/after.txt", "abcdef");
+
+        io::file_monitor monitor{};
+        monitor.open("stats/before.txt", std::fstream::in | std::fstream::out);
+        CHECK(monitor.stats_snapshot().empty());
+        CHECK(monitor.find("stats/before.txt")->second.stats == nullptr);
+
+        monitor.enable_stats(); // covers files already registered
+        CHECK(monitor.stats_enabled());
+        monitor.open("stats/after.txt", std::fstream::in);
+        monitor["stats/after.txt"];
+        monitor["stats/after.txt"];
+
+        // Manual recording of stream I/O.
+        auto& stats = *monitor.find("stats/after.txt")->second.stats;
+        stats.record(io::file_stats::op::read, 6, 100ns);
+        stats.record(io::file_stats::op::read, 6, 3000ns);
+
+        // `batch_io` records its operations itself.
+        {
+            io::batch_io batch{monitor};
+            std::array<std::byte, 4> buffer{};
+            batch.queue_read("stats/before.txt", buffer, 0);
+            batch.queue_write("stats/before.txt", std::as_bytes(std::span{"WXYZ", 4}), 6);
+            batch.submit();
+            std::vector<io::batch_io::completion> done{};
+            while (batch.in_flight() > 0) {
+                batch.wait(done, batch.in_flight());
+            }
+        }
+
+        const auto snapshot = monitor.stats_snapshot();
+        CHECK(snapshot.size() == 2);
+        for (const auto& [name, counters] : snapshot) {
+            if (name == "stats/after.txt") {
+                CHECK(counters.accesses == 2);
+                CHECK(counters.reads == 2 and counters.bytes_read == 12 and counters.writes == 0);
+                CHECK(counters.last_access >= counters.opened_at);
+                CHECK(io::file_stats_snapshot::percentile(counters.read_latency, 0.5) == 128ns);
+                CHECK(io::file_stats_snapshot::percentile(counters.read_latency, 1.0) == 4096ns);
+            } else {
+                CHECK(name == "stats/before.txt");
+                CHECK(counters.reads == 1 and counters.bytes_read == 4);
+                CHECK(counters.writes == 1 and counters.bytes_written == 4);
+            }
+        }
+    }
+
+    void test_file_monitor_stream_stats() {
+        using namespace faber;
+        using namespace std::chrono_literals;
+
+        write_text("stats/stream.txt", "hello world\n");
+
+        io::file_monitor monitor{};
+        monitor.enable_stats();
+        monitor.open("stats/stream.txt", std::fstream::in | std::fstream::out);
+
+        // One read fills the buffer, the words after it come from memory.
+        std::string first{}, second{};
+        *monitor["stats/stream.txt"].stream >> first >> second;
+        CHECK(first == "hello" and second == "world");
+
+        // Buffered writes are recorded once flushed, large ones as they bypass the buffer.
+        auto& stream = *monitor["stats/stream.txt"].stream;
+        stream.clear();
+        stream.seekp(0, std::ios::end);
+        stream << "more";
+        stream.flush();
+        const std::string large(64 * 1024, 'x');
+        stream.write(large.data(), static_cast<std::streamsize>(large.size()));
+        stream.flush();
+        CHECK(stream.good());
+
+        const auto snapshot = monitor.stats_snapshot();
+        CHECK(snapshot.size() == 1);
+        const auto& counters = snapshot.front().second;
+        CHECK(counters.accesses == 2);
+        CHECK(counters.reads == 1 and counters.bytes_read == 12);
+        CHECK(counters.writes >= 2 and counters.bytes_written == 4 + large.size());
+        CHECK(read_text("stats/stream.txt") == "hello world\nmore" + large);
+
+        // Fractions outside [0, 1] are clamped.
+        io::file_stats_snapshot::histogram h{};
+        h[3] = 1;
+        h[10] = 1;
+        CHECK(io::file_stats_snapshot::percentile(h, -1.0) == 8ns);
+        CHECK(io::file_stats_snapshot::percentile(h, 7.5) == 1024ns);
+    }
+
+    void test_concurrent_file_monitor() {
+        using namespace faber;
+
+        constexpr int threads = 4, per_thread = 25;
+        for (int t = 0; t < threads; ++t) {
+            for (int i = 0; i < per_thread; ++i) {
+                write_text("concurrent/" + std::to_string(t) + '_' + std::to_string(i), std::to_string(i));
+            }
+        }
+
+        io::concurrent_file_monitor monitor{4};
+        std::atomic<int> duplicates{0};
+        {
+            std::vector<std::jthread> workers{};
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (int i = 0; i < per_thread; ++i) {
+                        const auto path = "concurrent/" + std::to_string(t) + '_' + std::to_string(i);
+                        monitor.open(path.c_str(), std::fstream::in);
+                        try {
+                            monitor.open(path.c_str(), std::fstream::in);
+                        } catch (const std::runtime_error&) {
+                            duplicates.fetch_add(1);
+                        }
+                        if (i % 2 == 1) {
+                            monitor.close(path);
+                        }
+                    }
+                });
+            }
+        } // joins
+        CHECK(duplicates.load() == threads * per_thread);
+        CHECK(monitor.size() == threads * ((per_thread + 1) / 2)); // odd ones closed
+
+        std::size_t visited = 0;
+        monitor.for_each([&](std::string_view, io::concurrent_file_monitor::file_info_t& info) {
+            visited += info.stream->is_open() ? 1 : 0;
+        });
+        CHECK(visited == monitor.size());
+
+        CHECK(monitor.find("concurrent/0_1") == nullptr);
+        CHECK(monitor.find("concurrent/0_2") != nullptr);
+        std::string value{};
+        *monitor["concurrent/3_4"].stream >> value;
+        CHECK(value == "4");
+        CHECK(throws<std::out_of_range>([&] { monitor["concurrent/3_5"]; }));
+    }
+
+    /********** file_watcher **********/
+
+    void test_file_watcher_follows_renames() {
+        using namespace faber;
+
+        write_text("watch/a.txt", "1234");
+        write_text("watch/other/keep.txt", "");
+        fs::create_directories("unwatched");
+
+        io::file_monitor monitor{};
+        monitor.open("watch/a.txt", std::fstream::in);
+        monitor.open("watch/other/keep.txt", std::fstream::in);
+        io::file_watcher watcher{monitor};
+        CHECK(watcher.watched() == 2);
+
+        std::vector<io::file_watcher::event> events{};
+        const auto event_for = [&events](std::string_view path) -> const io::file_watcher::event* {
+            const auto it = std::ranges::find(events, path, &io::file_watcher::event::path);
+            return (it == events.end()) ? nullptr : &*it;
+        };
+
+        // Same directory: followed to the new name, still registered under the old one.
+        fs::rename("watch/a.txt", "watch/b.txt");
+        std::ofstream{"watch/b.txt", std::ios::app} << "5678";
+        watcher.poll(events, 1000);
+        const auto* e = event_for("watch/a.txt");
+        CHECK(e and (e->mask & io::file_watcher::moved) and not (e->mask & io::file_watcher::removed));
+        CHECK(e and e->location == "watch/b.txt" and e->size == 8);
+        CHECK(monitor.find("watch/a.txt")->second.size == 8);
+
+        // Into another watched directory.
+        events.clear();
+        fs::rename("watch/b.txt", "watch/other/c.txt");
+        std::ofstream{"watch/other/c.txt", std::ios::app} << "9";
+        watcher.poll(events, 1000);
+        e = event_for("watch/a.txt");
+        CHECK(e and e->location == "watch/other/c.txt" and e->size == 9 and not (e->mask & io::file_watcher::removed));
+
+        // Out of sight: no longer reachable by path.
+        events.clear();
+        fs::rename("watch/other/c.txt", "unwatched/d.txt");
+        watcher.poll(events, 1000);
+        e = event_for("watch/a.txt");
+        CHECK(e and (e->mask & io::file_watcher::removed) and e->location.empty());
+
+        monitor.close("watch/a.txt");
+        CHECK(watcher.watched() == 1);
+    }
+
+    void test_file_watcher_follows_replacements() {
+        using namespace faber;
+
+        write_text("replace/config.txt", "v0");
+
+        io::file_monitor monitor{};
+        monitor.open("replace/config.txt", std::fstream::in);
+        io::file_watcher watcher{monitor};
+
+        // Each durable write renames a new file over the watched one.
+        std::vector<io::file_watcher::event> events{};
+        for (const std::string contents : { "version 1", "second version" }) {
+            CHECK(io::write_file("replace/config.txt", [&contents](io::byte_sink& out) {
+                out.write(contents);
+                return true;
+            }, io::sink_options{ .durable = true }));
+
+            events.clear();
+            watcher.poll(events, 1000);
+            const auto it = std::ranges::find(events, std::string_view{"replace/config.txt"}, &io::file_watcher::event::path);
+            CHECK(it != events.end() and (it->mask & io::file_watcher::modified) and not (it->mask & io::file_watcher::removed));
+            CHECK(it != events.end() and it->size == contents.size() and it->location == "replace/config.txt");
+        }
+        CHECK(watcher.watched() == 1);
+
+        // Removed for good this time.
+        fs::remove("replace/config.txt");
+        events.clear();
+        watcher.poll(events, 1000);
+        CHECK(events.size() == 1 and (events.front().mask & io::file_watcher::removed));
+    }
+
+    /********** walk **********/
+
+    void test_walk_filters_and_depths() {
+        using namespace faber;
+
+        write_text("walk/a.txt", "");
+        write_text("walk/skip/hidden.txt", "");
+        write_text("walk/sub/b.txt", "");
+        write_text("walk/sub/deeper/c.txt", "");
+
+        std::vector<std::pair<std::string, std::size_t>> seen{};
+        CHECK(io::walk("walk", [&](const io::dir_entry& entry) {
+            if (entry.type == io::entry_type::regular) {
+                seen.emplace_back(std::string{entry.path}, entry.depth);
+            }
+        }, [](const io::dir_entry& entry) {
+            return entry.name != "skip"; // pruned, never opened
+        }));
+        std::ranges::sort(seen);
+        const std::vector<std::pair<std::string, std::size_t>> expected{
+            { "walk/a.txt", 0 }, { "walk/sub/b.txt", 1 }, { "walk/sub/deeper/c.txt", 2 }
+        };
+        CHECK(seen == expected);
+
+        CHECK(not io::walk("walk/missing", [](const io::dir_entry&) { }));
+        CHECK(not io::parallel_walk("walk/a.txt", [](const io::dir_entry&) { }));
+    }
+
+    void test_walk_closes_on_throw() {
+        using namespace faber;
+
+        write_text("walk_throw/x/y/z.txt", "");
+        const auto before = open_descriptors();
+
+        CHECK(throws<std::runtime_error>([] {
+            io::walk("walk_throw", [](const io::dir_entry& entry) {
+                if (entry.name == "z.txt") { throw std::runtime_error{"stop"}; }
+            });
+        }));
+        CHECK(throws<std::runtime_error>([] {
+            io::parallel_walk("walk_throw", [](const io::dir_entry& entry) {
+                if (entry.name == "z.txt") { throw std::runtime_error{"stop"}; }
+            }, {}, 2);
+        }));
+        CHECK(open_descriptors() == before);
+    }
+
+    /********** records **********/
+
+    void test_records_cross_block_boundaries() {
+        using namespace faber;
+
+        // Records shorter than, equal to and much longer than a block, empty ones
+        // and a trailing one with no delimiter after it.
+        const std::vector<std::string> expected{
+            "a", "bcdefgh", "", "ijklmnopqrstuvwxyz0123456789", "x", "", "yz", std::string(100, 'q'), "tail"
+        };
+        std::string contents{};
+        for (const auto& record : expected) {
+            contents += record + ';';
+        }
+        contents.pop_back();
+        write_text("records.txt", contents);
+
+        for (const std::size_t block_size : { 1, 3, 7, 8, 64, 4096 }) {
+            std::vector<std::string> records{};
+            const bool complete = io::for_each_record("records.txt", ';', [&records](std::string_view record) {
+                records.emplace_back(record);
+            }, block_size);
+            CHECK(complete);
+            CHECK(records == expected);
+        }
+
+        std::size_t seen = 0;
+        CHECK(not io::for_each_record("records.txt", ';', [&seen](std::string_view) { return ++seen < 3; }, 4));
+        CHECK(seen == 3);
+    }
+
+    void test_records_close_on_throw() {
+        using namespace faber;
+
+        write_text("lines.txt", "one\ntwo\nthree\n");
+        const auto before = open_descriptors();
+        CHECK(throws<std::runtime_error>([] {
+            io::for_each_line("lines.txt", [](std::string_view line) {
+                if (line == "two") {
+                    throw std::runtime_error{"stop"};
+                }
+            });
+        }));
+        CHECK(open_descriptors() == before);
+    }
+
+    void test_parallel_read_file() {
+        using namespace faber;
+
+        std::string contents{};
+        for (int i = 0; i < 5000; ++i) {
+            contents += "record " + std::to_string(i) + '\n';
+        }
+        contents += "unterminated";
+        write_text("parallel.txt", contents);
+
+        // Ranges of whole records, every line seen exactly once.
+        std::atomic<std::size_t> lines{0};
+        std::atomic<bool> whole{true};
+        CHECK(io::parallel_read_file("parallel.txt", 256, [&](std::string_view chunk) {
+            lines += static_cast<std::size_t>(std::ranges::count(chunk, '\n'));
+            if (chunk.back() != '\n' and not chunk.ends_with("unterminated")) {
+                whole = false;
+            }
+        }, '\n', 4));
+        CHECK(lines.load() == 5000 and whole.load());
+
+        // Partial results are folded in file order: concatenation rebuilds the file.
+        const auto rebuilt = io::parallel_read_file("parallel.txt", 256,
+            [](std::string_view chunk) { return std::string{chunk}; },
+            [](std::string a, std::string b) { return a + b; }, '\n', 4);
+        CHECK(rebuilt and *rebuilt == contents);
+
+        // Stopping early and exceptions.
+        CHECK(not io::parallel_read_file("parallel.txt", 256, [](std::string_view chunk) {
+            return chunk.find("record 10\n") == std::string_view::npos;
+        }, '\n', 2));
+        CHECK(throws<std::runtime_error>([] {
+            io::parallel_read_file("parallel.txt", 256, [](std::string_view) -> bool {
+                throw std::runtime_error{"map failed"};
+            });
+        }));
+        CHECK(not io::parallel_read_file("missing.txt", 256, [](std::string_view) { return 0; }, std::plus<>{}));
+    }
+
+    /********** batch_io **********/
+
+    void test_batch_io_round_trip() {
+        using namespace faber;
+
+        write_text("batch.bin", std::string(8192, 'x'));
+
+        io::file_monitor monitor{};
+        monitor.open("batch.bin", std::fstream::in | std::fstream::out);
+        io::batch_io batch{monitor, 4};
+
+        // More operations than the queue depth, split transparently.
+        std::vector<std::string> blocks{};
+        for (char c = 'a'; c < 'a' + 8; ++c) {
+            blocks.emplace_back(1024, c);
+        }
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            batch.queue_write("batch.bin", std::as_bytes(std::span{blocks[i]}), i * 1024);
+        }
+        CHECK(batch.submit() == blocks.size());
+
+        std::vector<io::batch_io::completion> done{};
+        while (batch.in_flight() > 0) {
+            batch.wait(done, batch.in_flight());
+        }
+        CHECK(done.size() == blocks.size());
+        CHECK(std::ranges::all_of(done, [](const auto& c) { return c.result == 1024; }));
+
+        std::array<std::byte, 1024> buffer{};
+        const auto id = batch.queue_read("batch.bin", buffer, 3 * 1024);
+        batch.submit();
+        done.clear();
+        batch.wait(done, 1);
+        CHECK(done.size() == 1 and done.front().id == id and done.front().result == 1024);
+        CHECK(std::ranges::all_of(buffer, [](std::byte b) { return b == std::byte{'d'}; }));
+
+        CHECK(throws<std::runtime_error>([&] { batch.queue_read("unknown.bin", buffer, 0); }));
+    }
+
+    void test_batch_io_rejects_long_operations() {
+        using namespace faber;
+
+        write_text("long.bin", "");
+        io::file_monitor monitor{};
+        monitor.open("long.bin", std::fstream::in);
+        io::batch_io batch{monitor};
+
+        // Address space only, never touched: the length is rejected before anything is queued.
+        const std::size_t length = io::batch_io::max_length + 1;
+        void* region = ::mmap(nullptr, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        CHECK(region != MAP_FAILED);
+        if (region != MAP_FAILED) {
+            const std::span<std::byte> huge{static_cast<std::byte*>(region), length};
+            CHECK(throws<std::runtime_error>([&] { batch.queue_read("long.bin", huge, 0); }));
+            CHECK(batch.submit() == 0);
+            ::munmap(region, length);
+        }
+    }
+
+    void test_batch_io_reopens_replaced_files() {
+        using namespace faber;
+
+        write_text("replaced.bin", "old contents");
+        io::file_monitor monitor{};
+        monitor.open("replaced.bin", std::fstream::in);
+        io::batch_io batch{monitor};
+
+        std::array<std::byte, 12> buffer{};
+        std::vector<io::batch_io::completion> done{};
+        batch.queue_read("replaced.bin", buffer, 0);
+        batch.submit();
+        batch.wait(done, 1);
+
+        // Recreated under the same name, the cached descriptor still leads to the old inode.
+        monitor.close("replaced.bin");
+        write_text("replaced.tmp", "new contents");
+        std::filesystem::rename("replaced.tmp", "replaced.bin");
+        monitor.open("replaced.bin", std::fstream::in);
+
+        done.clear();
+        batch.queue_read("replaced.bin", buffer, 0);
+        batch.submit();
+        batch.wait(done, 1);
+        CHECK(done.size() == 1 and done.front().result == 12);
+        CHECK(std::string(reinterpret_cast<const char*>(buffer.data()), buffer.size()) == "new contents");
+    }
+
+    /********** fd_stream **********/
+
+    void test_fd_stream_modes() {
+        using namespace faber;
+
+        io::buffer_pool pool{64};
+        {
+            io::fd_stream out{"fd/stream.txt", std::ios_base::out | std::ios_base::binary, pool};
+            CHECK(not out.is_open()); // parent directory missing
+        }
+        fs::create_directories("fd");
+
+        {
+            io::fd_stream out{"fd/stream.txt", std::ios_base::out | std::ios_base::trunc, pool};
+            CHECK(out.is_open());
+            out << std::string(200, 'a'); // larger than the buffer, bypasses it
+            out << "tail";
+        }
+        {
+            io::fd_stream out{"fd/stream.txt", std::ios_base::app, pool};
+            out << "+app";
+        }
+        CHECK(read_text("fd/stream.txt") == std::string(200, 'a') + "tail+app");
+
+        io::fd_stream in{"fd/stream.txt", std::ios_base::in | std::ios_base::ate, pool};
+        CHECK(in.is_open());
+        in.seekg(200);
+        std::string word{};
+        in >> word;
+        CHECK(word == "tail+app");
+
+        // `trunc` without `out` is not a valid combination.
+        io::fd_stream invalid{"fd/stream.txt", std::ios_base::in | std::ios_base::trunc, pool};
+        CHECK(not invalid.is_open() and invalid.fail());
+        CHECK(read_text("fd/stream.txt") == std::string(200, 'a') + "tail+app");
+    }
+
+    void test_buffer_pool_reuse() {
+        using namespace faber;
+
+        write_text("pool.txt", "pooled");
+        io::buffer_pool pool{};
+        for (int i = 0; i < 16; ++i) {
+            io::pooled_fstream stream{pool};
+            stream.open("pool.txt", std::ios_base::in);
+            std::string text{};
+            stream >> text;
+            CHECK(text == "pooled");
+        }
+        CHECK(pool.allocated() == 1);
+
+        // A given back buffer is reused by the next stream, the idle one stays usable.
+        io::pooled_fstream idle{pool};
+        idle.give_back();
+        io::pooled_fstream other{pool};
+        CHECK(pool.allocated() == 1);
+        idle.open("pool.txt", std::ios_base::in);
+        std::string text{};
+        idle >> text;
+        CHECK(text == "pooled");
+        idle.close();
+        idle.borrow();
+        CHECK(pool.allocated() == 2);
+    }
+
+    /********** byte_sink **********/
+
+    void test_byte_sink_writes() {
+        using namespace faber;
+
+        // Small buffer: puts spill over it, large writes bypass it with `writev`.
+        const io::sink_options small{ .buffer_size = 1 };
+        std::string expected{};
+        {
+            io::byte_sink sink{"sink/out.bin", small};
+            CHECK(not sink.is_open()); // parent directory missing
+        }
+        fs::create_directories("sink");
+        {
+            io::byte_sink sink{"sink/out.bin", small};
+            CHECK(sink.is_open() and sink.good());
+            for (int i = 0; i < 10'000; ++i) {
+                sink.put(static_cast<char>('a' + i % 26));
+                expected += static_cast<char>('a' + i % 26);
+            }
+            const std::string large(100'000, 'L');
+            sink.write(large);
+            expected += large;
+            sink.write(std::as_bytes(std::span{"tail", 4}));
+            expected += "tail";
+            CHECK(sink.bytes_written() == expected.size());
+            CHECK(sink.close());
+            CHECK(not sink.is_open());
+        }
+        CHECK(read_text("sink/out.bin") == expected);
+
+        // Reopening truncates.
+        CHECK(io::write_file("sink/out.bin", [](io::byte_sink& out) {
+            out.write("short");
+            return out.good();
+        }));
+        CHECK(read_text("sink/out.bin") == "short");
+
+        // `O_DIRECT`, or buffered output where the filesystem refuses it: same bytes either way.
+        std::string blocks{};
+        for (int i = 0; i < 3000; ++i) {
+            blocks += std::to_string(i) + ',';
+        }
+        CHECK(io::write_file("sink/direct.bin", [&](io::byte_sink& out) {
+            out.write(blocks);
+            out.flush();
+            out.write(blocks);
+            return out.good();
+        }, io::sink_options{ .buffer_size = 4096, .direct = true }));
+        CHECK(read_text("sink/direct.bin") == blocks + blocks);
+
+        CHECK(not io::write_file("sink/missing/out.bin", [](io::byte_sink&) { return true; }));
+    }
+
+    void test_durable_write_aborts() {
+        using namespace faber;
+
+        write_text("durable/target.txt", "old contents");
+        const io::sink_options durable{ .durable = true };
+
+        // Callback gives up: the target is untouched.
+        CHECK(not io::write_file("durable/target.txt", [](io::byte_sink& out) {
+            out.write("partial");
+            return false;
+        }, durable));
+        CHECK(read_text("durable/target.txt") == "old contents");
+
+        // Callback throws: the sink is destroyed unclosed and must not commit.
+        CHECK(throws<std::runtime_error>([&] {
+            io::write_file("durable/target.txt", [](io::byte_sink& out) -> bool {
+                out.write("partial");
+                throw std::runtime_error{"interrupted"};
+            }, durable);
+        }));
+        CHECK(read_text("durable/target.txt") == "old contents");
+
+        // Same through a sink going out of scope by hand.
+        {
+            io::byte_sink sink{"durable/target.txt", durable};
+            CHECK(sink.is_open());
+            sink.write("abandoned");
+        }
+        CHECK(read_text("durable/target.txt") == "old contents");
+        CHECK(count_prefixed("durable", "target.txt.tmp.") == 0);
+
+        // Completed write replaces the target.
+        CHECK(io::write_file("durable/target.txt", [](io::byte_sink& out) {
+            out.write("new contents");
+            return out.good();
+        }, durable));
+        CHECK(read_text("durable/target.txt") == "new contents");
+        CHECK(count_prefixed("durable", "target.txt.tmp.") == 0);
+    }
+
+    void test_commit_group_shares_flushes() {
+        using namespace faber;
+
+        fs::create_directories("group");
+        for (const auto how : { io::commit_group::strategy::syncfs, io::commit_group::strategy::fdatasync }) {
+            io::commit_group group{how};
+            constexpr int threads = 8, per_thread = 4;
+            std::atomic<int> written{0};
+            {
+                std::vector<std::jthread> workers{};
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&, t] {
+                        for (int i = 0; i < per_thread; ++i) {
+                            const auto name = "group/" + std::to_string(t) + '_' + std::to_string(i);
+                            written += io::write_file(name, [&](io::byte_sink& out) {
+                                out.write(name);
+                                return out.good();
+                            }, io::sink_options{ .durable = true, .group = &group }) ? 1 : 0;
+                        }
+                    });
+                }
+            } // joins
+            CHECK(written.load() == threads * per_thread);
+            CHECK(group.requests() == 2u * threads * per_thread); // each file, then its directory
+            CHECK(group.flushes() > 0 and group.flushes() <= group.requests());
+            CHECK(read_text("group/3_2") == "group/3_2");
+        }
+        CHECK(count_prefixed("group", "") == 8 * 4); // no temporary left behind
+    }
+
+    /********** copy_file & transfer **********/
+
+    void test_copy_file_parallel() {
+        using namespace faber;
+
+        std::string contents{};
+        for (int i = 0; contents.size() < 100'000; ++i) {
+            contents += std::to_string(i) + '\n';
+        }
+        write_text("copy/source.txt", contents);
+
+        // Small chunks and threshold: several chunks per worker, the last one partial.
+        const io::copy_options parallel{ .reflink = false, .parallel_threshold = 1, .chunk_size = 4096, .threads = 3 };
+        CHECK(io::copy_file("copy/source.txt", "copy/nested/copy.txt", parallel));
+        CHECK(read_text("copy/nested/copy.txt") == contents);
+
+        // Overwriting a larger file leaves no stale tail.
+        write_text("copy/larger.txt", contents + contents);
+        CHECK(io::copy_file("copy/source.txt", "copy/larger.txt", parallel));
+        CHECK(read_text("copy/larger.txt") == contents);
+
+        // Copying a file onto itself keeps it.
+        CHECK(io::copy_file("copy/source.txt", "copy/source.txt"));
+        CHECK(read_text("copy/source.txt") == contents);
+
+        // Permissions follow the source, onto an existing destination too.
+        fs::permissions("copy/source.txt", fs::perms::owner_read | fs::perms::owner_write | fs::perms::owner_exec);
+        CHECK(io::copy_file("copy/source.txt", "copy/larger.txt"));
+        CHECK(fs::status("copy/larger.txt").permissions() == (fs::perms::owner_read | fs::perms::owner_write | fs::perms::owner_exec));
+    }
+
+    void test_copy_file_keeps_existing_destination() {
+        using namespace faber;
+
+        write_text("keep/source.txt", "new");
+        write_text("keep/existing.txt", "precious");
+
+        const io::copy_options no_overwrite{ .overwrite = false };
+        CHECK(not io::copy_file("keep/source.txt", "keep/existing.txt", no_overwrite));
+        CHECK(read_text("keep/existing.txt") == "precious");
+
+        CHECK(not io::transfer("keep/source.txt", "keep/existing.txt", no_overwrite));
+        CHECK(read_text("keep/existing.txt") == "precious");
+        CHECK(read_text("keep/source.txt") == "new");
+
+        CHECK(io::transfer("keep/source.txt", "keep/moved/source.txt", no_overwrite));
+        CHECK(not fs::exists("keep/source.txt"));
+        CHECK(read_text("keep/moved/source.txt") == "new");
+
+        CHECK(io::transfer("keep/moved/source.txt", "keep/existing.txt"));
+        CHECK(read_text("keep/existing.txt") == "new");
+    }
+
+    /********** async **********/
+
+    /** Minimal eager, fire-and-forget coroutine type to drive the awaitables. */
+    struct detached {
+        struct promise_type {
+            detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept { }
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    /** Queues tasks until `drain` runs them on the calling thread, as an event loop would. */
+    class queued_executor final : public faber::io::executor {
+    public:
+        void execute(std::function<void()> task) override {
+            _queue.push_back(std::move(task));
+        }
+
+        /** Runs queued tasks, those they queue included, until none is left. @returns How many ran. */
+        int drain() {
+            int ran = 0;
+            while (not _queue.empty()) {
+                auto task = std::move(_queue.front());
+                _queue.pop_front();
+                task();
+                ++ran;
+            }
+            return ran;
+        }
+
+    private:
+        std::deque<std::function<void()>> _queue{};
+    };
+
+    struct async_results {
+        bool            wrote{false};
+        std::string     line{};
+        std::size_t     mapped_size{0};
+        bool            rethrown{false};
+        bool            off_caller{false};
+    };
+
+    detached run_async_operations(faber::io::executor& ex, std::thread::id caller, std::promise<async_results>& done) {
+        using namespace faber;
+
+        async_results r{};
+        r.wrote = co_await io::async_write_file("async.txt", [](io::byte_sink& out) {
+            out.write("written asynchronously\n");
+            return out.good();
+        }, io::sink_options{}, ex);
+
+        co_await io::async_read_file("async.txt", [&r](std::fstream& file) {
+            return static_cast<bool>(std::getline(file, r.line));
+        }, std::fstream::in, ex);
+
+        co_await io::async_read_file("async.txt", [&r](std::span<const std::byte> bytes) {
+            r.mapped_size = bytes.size();
+            return true;
+        }, ex);
+
+        try {
+            co_await io::offload([]() -> int { throw std::runtime_error{"failed on the executor"}; }, ex);
+        } catch (const std::runtime_error&) {
+            r.rethrown = true;
+        }
+
+        r.off_caller = std::this_thread::get_id() != caller;
+        done.set_value(std::move(r));
+    }
+
+    void test_async_offload() {
+        using namespace faber;
+
+        {
+            io::pool_executor pool{2};
+            CHECK(pool.size() == 2);
+            std::promise<async_results> done{};
+            auto future = done.get_future();
+            run_async_operations(pool, std::this_thread::get_id(), done);
+            const auto r = future.get();
+            CHECK(r.wrote and r.line == "written asynchronously");
+            CHECK(r.mapped_size == r.line.size() + 1);
+            CHECK(r.rethrown);
+            CHECK(r.off_caller); // resumed on the pool
+        }
+
+        // Any executor can be plugged in. Nothing runs until the loop drains the queue.
+        queued_executor loop{};
+        std::promise<async_results> done{};
+        auto future = done.get_future();
+        run_async_operations(loop, std::this_thread::get_id(), done);
+        CHECK(future.wait_for(std::chrono::seconds{0}) == std::future_status::timeout);
+        CHECK(loop.drain() == 4);
+        const auto r = future.get();
+        CHECK(r.wrote and r.line == "written asynchronously" and r.rethrown);
+        CHECK(not r.off_caller);
+    }
+
+    /********** metadata **********/
+
+    void test_stat_files_large_sizes() {
+        using namespace faber;
+
+        // Sparse: no blocks are allocated, only the size is past 4 GiB.
+        constexpr std::uint64_t large = 5ull << 30;
+        write_text("meta/large.bin", "");
+        fs::resize_file("meta/large.bin", large);
+        write_text("meta/small.txt", "12345");
+
+        std::vector<std::string> paths{ "meta/large.bin", "meta/missing", "meta" };
+        for (int i = 0; i < 100; ++i) {
+            paths.push_back("meta/small.txt"); // several batches, spread over threads
+        }
+        const auto metadata = io::stat_files(paths, 4);
+        CHECK(metadata.size() == paths.size());
+        CHECK(metadata[0].exists() and metadata[0].size == large);
+        CHECK(metadata[0].type == fs::file_type::regular);
+        CHECK(not metadata[1].exists() and metadata[1].type == fs::file_type::not_found);
+        CHECK(metadata[2].type == fs::file_type::directory);
+        CHECK(std::all_of(metadata.begin() + 3, metadata.end(), [](const auto& m) { return m.size == 5; }));
+    }
+
+    void test_metadata_cache() {
+        using namespace faber;
+
+        write_text("cache/a.txt", "a");
+        write_text("cache/b.txt", "bb");
+
+        io::metadata_cache cache{2};
+        CHECK(cache.fetch({ "cache/a.txt", "cache/b.txt" }) == 2);
+        CHECK(cache.fetch({ "cache/a.txt", "cache/c.txt" }) == 1); // only the missing one
+        CHECK(cache.size() == 3);
+        CHECK(cache.find("cache/b.txt") and cache.find("cache/b.txt")->size == 2);
+        CHECK(cache.find("cache/c.txt") and not cache.find("cache/c.txt")->exists());
+
+        // Stale until refreshed.
+        write_text("cache/b.txt", "bbbb");
+        CHECK(cache.get("cache/b.txt").size == 2);
+        CHECK(cache.refresh({ "cache/b.txt" }) == 1);
+        CHECK(cache.get("cache/b.txt").size == 4);
+
+        // Duplicates are queried once, and reported at every position.
+        CHECK(cache.refresh({ "cache/a.txt", "cache/b.txt", "cache/a.txt" }) == 2);
+        const auto repeated = io::stat_files({ "cache/b.txt", "cache/a.txt", "cache/b.txt" });
+        CHECK(repeated.size() == 3 and repeated[0].size == 4 and repeated[1].size == 1 and repeated[2].size == 4);
+
+        CHECK(cache.get("cache/d.txt").error != 0); // queried on the spot
+        CHECK(cache.invalidate("cache/a.txt"));
+        CHECK(not cache.invalidate("cache/a.txt"));
+        CHECK(cache.find("cache/a.txt") == nullptr);
+        cache.invalidate();
+        CHECK(cache.size() == 0);
+    }
+
+    void test_prefetch_and_parallel_walk() {
+        using namespace faber;
+
+        std::vector<std::string> files{};
+        for (int d = 0; d < 4; ++d) {
+            for (int f = 0; f < 5; ++f) {
+                files.push_back("tree/" + std::to_string(d) + "/sub/" + std::to_string(f) + ".txt");
+                write_text(files.back(), "x");
+            }
+        }
+        auto with_missing = files;
+        with_missing.push_back("tree/missing.txt");
+        CHECK(io::prefetch(with_missing, 3) == files.size());
+
+        std::atomic<std::size_t> regular{0};
+        std::atomic<std::size_t> directories{0};
+        CHECK(io::parallel_walk("tree", [&](const io::dir_entry& entry) {
+            (entry.type == io::entry_type::directory ? directories : regular).fetch_add(1);
+        }, {}, 3));
+        CHECK(regular.load() == files.size());
+        CHECK(directories.load() == 8);
+    }
+
+} // namespace
+
+int main() {
+    const auto scratch = fs::temp_directory_path() / ("faber_test." + std::to_string(::getpid()));
+    fs::create_directories(scratch);
+    fs::current_path(scratch);
+
+    test_read_all();
+    test_filesize();
+    test_flat_table_erase_and_rehash();
+    test_path_arena_reuses_blocks();
+    test_file_monitor_smoke();
+    test_file_monitor_mapped_only();
+    test_read_file_mapped();
+    test_file_monitor_resource();
+    test_file_monitor_lru();
+    test_file_monitor_records_hints();
+    test_file_monitor_warm();
+    test_file_monitor_stats();
+    test_file_monitor_stream_stats();
+    test_concurrent_file_monitor();
+    test_file_watcher_follows_renames();
+    test_file_watcher_follows_replacements();
+    test_walk_filters_and_depths();
+    test_walk_closes_on_throw();
+    test_records_cross_block_boundaries();
+    test_records_close_on_throw();
+    test_parallel_read_file();
+    test_batch_io_round_trip();
+    test_batch_io_reopens_replaced_files();
+    test_batch_io_rejects_long_operations();
+    test_fd_stream_modes();
+    test_buffer_pool_reuse();
+    test_byte_sink_writes();
+    test_durable_write_aborts();
+    test_commit_group_shares_flushes();
+    test_copy_file_parallel();
+    test_copy_file_keeps_existing_destination();
+    test_async_offload();
+    test_stat_files_large_sizes();
+    test_metadata_cache();
+    test_prefetch_and_parallel_walk();
+
+    fs::current_path(scratch.parent_path());
+    fs::remove_all(scratch);
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return EXIT_FAILURE;
     }
+    std::cout << "all checks passed\n";
+    return EXIT_SUCCESS;
 }